@@ -119,6 +119,25 @@ class DiscreteDistribution
     return probabilities(obs);
   }
 
+  /**
+   * Calculate the log-probability of each of the given observations (one per
+   * column; only the first dimension is used), storing the results in the
+   * given vector.  As with Probability(), no bounds checking is performed.
+   *
+   * @param observations List of observations.
+   * @param logProbabilities Output log-probabilities for each observation.
+   */
+  void LogProbability(const arma::mat& observations,
+                      arma::vec& logProbabilities) const
+  {
+    // Adding 0.5 helps ensure that we cast the floating point to a size_t
+    // correctly.
+    const arma::uvec obs = arma::conv_to<arma::uvec>::from(
+        observations.row(0) + 0.5);
+
+    logProbabilities = log(probabilities.elem(obs));
+  }
+
   /**
    * Return a randomly generated observation (one-dimensional vector; one
    * observation) according to the probability distribution defined by this
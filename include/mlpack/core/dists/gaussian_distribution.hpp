@@ -72,6 +72,21 @@ class GaussianDistribution
     return mlpack::gmm::phi(observation, mean, covariance);
   }
 
+  /**
+   * Calculate the log-probability of each of the given observations (one per
+   * column), storing the results in the given vector.  The covariance is
+   * factorized only once for the whole matrix, so this is much faster than
+   * calling Probability() on each observation.
+   *
+   * @param observations List of observations.
+   * @param logProbabilities Output log-probabilities for each observation.
+   */
+  void LogProbability(const arma::mat& observations,
+                      arma::vec& logProbabilities) const
+  {
+    mlpack::gmm::LogPhi(observations, mean, covariance, logProbabilities);
+  }
+
   /**
    * Return a randomly generated observation according to the probability
    * distribution defined by this object.
@@ -92,6 +92,25 @@ class LaplaceDistribution
    */
   double Probability(const arma::vec& observation) const;
 
+  /**
+   * Calculate the log-probability of each of the given observations (one per
+   * column), storing the results in the given vector.  This is inlined for
+   * speed.
+   *
+   * @param observations List of observations.
+   * @param logProbabilities Output log-probabilities for each observation.
+   */
+  void LogProbability(const arma::mat& observations,
+                      arma::vec& logProbabilities) const
+  {
+    // The distance of each observation from the mean.
+    arma::mat diffs = observations;
+    diffs.each_col() -= mean;
+
+    logProbabilities = -std::log(2.0 * scale) -
+        trans(sqrt(arma::sum(arma::square(diffs), 0))) / scale;
+  }
+
   /**
    * Return a randomly generated observation according to the probability
    * distribution defined by this object.  This is inlined for speed.
@@ -0,0 +1,211 @@
+/**
+ * @file kernel_matrix.hpp
+ *
+ * Functions to compute the matrix of kernel evaluations between two sets of
+ * points, in parallel, with fast paths for kernels which only depend on dot
+ * products or distances.
+ *
+ * This file is part of MLPACK 1.0.10.
+ *
+ * MLPACK is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * MLPACK is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details (LICENSE.txt).
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * MLPACK.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __MLPACK_CORE_KERNELS_KERNEL_MATRIX_HPP
+#define __MLPACK_CORE_KERNELS_KERNEL_MATRIX_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace kernel {
+
+/**
+ * Compute the kernel matrix between the points in a and the points in b; that
+ * is, output(i, j) = K(a_i, b_j).  The matrix is split into square tiles, which
+ * are computed in parallel (if OpenMP is available), each thread with its own
+ * copy of the kernel.
+ *
+ * For the LinearKernel, PolynomialKernel and GaussianKernel, overloads are
+ * given which compute the matrix of dot products with a single matrix
+ * multiplication and then transform it elementwise; these are much faster.
+ *
+ * @param kernel Kernel to evaluate.
+ * @param a First set of points (one point per column).
+ * @param b Second set of points (one point per column).
+ * @param output Matrix to store the kernel matrix in (a.n_cols x b.n_cols).
+ */
+template<typename KernelType>
+void KernelMatrix(const KernelType& kernel,
+                  const arma::mat& a,
+                  const arma::mat& b,
+                  arma::mat& output)
+{
+  // The number of points on each side of a tile.
+  const size_t tileSize = 64;
+  const size_t rowTiles = (a.n_cols + tileSize - 1) / tileSize;
+  const size_t colTiles = (b.n_cols + tileSize - 1) / tileSize;
+
+  output.set_size(a.n_cols, b.n_cols);
+
+  #pragma omp parallel
+  {
+    KernelType threadKernel(kernel);
+
+    #pragma omp for schedule(dynamic)
+    for (size_t tile = 0; tile < rowTiles * colTiles; ++tile)
+    {
+      const size_t rowBegin = (tile % rowTiles) * tileSize;
+      const size_t rowEnd = std::min(rowBegin + tileSize, (size_t) a.n_cols);
+      const size_t colBegin = (tile / rowTiles) * tileSize;
+      const size_t colEnd = std::min(colBegin + tileSize, (size_t) b.n_cols);
+
+      for (size_t j = colBegin; j < colEnd; ++j)
+        for (size_t i = rowBegin; i < rowEnd; ++i)
+          output(i, j) = threadKernel.Evaluate(a.unsafe_col(i),
+                                               b.unsafe_col(j));
+    }
+  }
+}
+
+/**
+ * Compute the symmetric kernel matrix of the points in data; that is,
+ * output(i, j) = K(data_i, data_j).  Only the tiles on and above the diagonal
+ * are evaluated (in parallel, if OpenMP is available), and the rest of the
+ * matrix is filled in by symmetry.
+ *
+ * @param kernel Kernel to evaluate.
+ * @param data Points (one point per column).
+ * @param output Matrix to store the kernel matrix in.
+ */
+template<typename KernelType>
+void KernelMatrix(const KernelType& kernel,
+                  const arma::mat& data,
+                  arma::mat& output)
+{
+  const size_t tileSize = 64;
+  const size_t tiles = (data.n_cols + tileSize - 1) / tileSize;
+
+  output.set_size(data.n_cols, data.n_cols);
+
+  #pragma omp parallel
+  {
+    KernelType threadKernel(kernel);
+
+    #pragma omp for schedule(dynamic)
+    for (size_t tile = 0; tile < tiles * tiles; ++tile)
+    {
+      const size_t rowTile = tile % tiles;
+      const size_t colTile = tile / tiles;
+      if (rowTile > colTile)
+        continue;
+
+      const size_t rowBegin = rowTile * tileSize;
+      const size_t rowEnd = std::min(rowBegin + tileSize,
+          (size_t) data.n_cols);
+      const size_t colBegin = colTile * tileSize;
+      const size_t colEnd = std::min(colBegin + tileSize,
+          (size_t) data.n_cols);
+
+      for (size_t j = colBegin; j < colEnd; ++j)
+        for (size_t i = rowBegin; i < std::min(rowEnd, j + 1); ++i)
+          output(i, j) = threadKernel.Evaluate(data.unsafe_col(i),
+                                               data.unsafe_col(j));
+    }
+  }
+
+  output = arma::symmatu(output);
+}
+
+//! Compute the linear kernel matrix between a and b with a single matrix
+//! multiplication.
+inline void KernelMatrix(const LinearKernel& /* kernel */,
+                         const arma::mat& a,
+                         const arma::mat& b,
+                         arma::mat& output)
+{
+  output = trans(a) * b;
+}
+
+//! Compute the symmetric linear kernel matrix of the data with a single matrix
+//! multiplication.
+inline void KernelMatrix(const LinearKernel& /* kernel */,
+                         const arma::mat& data,
+                         arma::mat& output)
+{
+  output = arma::symmatu(trans(data) * data);
+}
+
+//! Compute the polynomial kernel matrix between a and b from the matrix of dot
+//! products.
+inline void KernelMatrix(const PolynomialKernel& kernel,
+                         const arma::mat& a,
+                         const arma::mat& b,
+                         arma::mat& output)
+{
+  output = trans(a) * b;
+
+  #pragma omp parallel for schedule(static)
+  for (size_t j = 0; j < output.n_cols; ++j)
+    for (size_t i = 0; i < output.n_rows; ++i)
+      output(i, j) = pow(output(i, j) + kernel.Offset(), kernel.Degree());
+}
+
+//! Compute the symmetric polynomial kernel matrix of the data from the matrix
+//! of dot products.
+inline void KernelMatrix(const PolynomialKernel& kernel,
+                         const arma::mat& data,
+                         arma::mat& output)
+{
+  KernelMatrix(kernel, data, data, output);
+  output = arma::symmatu(output);
+}
+
+//! Compute the Gaussian kernel matrix between a and b from the matrix of dot
+//! products, using ||a_i - b_j||^2 = ||a_i||^2 + ||b_j||^2 - 2 a_i^T b_j.
+inline void KernelMatrix(const GaussianKernel& kernel,
+                         const arma::mat& a,
+                         const arma::mat& b,
+                         arma::mat& output)
+{
+  const arma::vec aNorms = trans(arma::sum(arma::square(a), 0));
+  const arma::vec bNorms = trans(arma::sum(arma::square(b), 0));
+
+  output = trans(a) * b;
+
+  #pragma omp parallel for schedule(static)
+  for (size_t j = 0; j < output.n_cols; ++j)
+  {
+    for (size_t i = 0; i < output.n_rows; ++i)
+    {
+      // Roundoff can make the squared distance slightly negative.
+      const double sqDistance = std::max(aNorms[i] + bNorms[j] -
+          2 * output(i, j), 0.0);
+      output(i, j) = exp(kernel.Gamma() * sqDistance);
+    }
+  }
+}
+
+//! Compute the symmetric Gaussian kernel matrix of the data from the matrix of
+//! dot products.
+inline void KernelMatrix(const GaussianKernel& kernel,
+                         const arma::mat& data,
+                         arma::mat& output)
+{
+  KernelMatrix(kernel, data, data, output);
+  output = arma::symmatu(output);
+  output.diag().ones();
+}
+
+}; // namespace kernel
+}; // namespace mlpack
+
+#endif
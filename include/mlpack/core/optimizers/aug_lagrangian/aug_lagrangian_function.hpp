@@ -23,6 +23,7 @@
 #define __MLPACK_CORE_OPTIMIZERS_AUG_LAGRANGIAN_AUG_LAGRANGIAN_FUNCTION_HPP
 
 #include <mlpack/core.hpp>
+#include <mlpack/core/optimizers/evaluate_with_gradient.hpp>
 
 namespace mlpack {
 namespace optimization {
@@ -86,6 +87,21 @@ class AugLagrangianFunction
    */
   void Gradient(const arma::mat& coordinates, arma::mat& gradient) const;
 
+  /**
+   * Evaluate both the objective function and the gradient of the Augmented
+   * Lagrangian function.  Each constraint is only evaluated once, and the
+   * LagrangianFunction's own EvaluateWithGradient() is used.  The optimizers
+   * only use this if the LagrangianFunction has an EvaluateWithGradient() (see
+   * HasEvaluateWithGradient below); otherwise they call Evaluate() and only
+   * call Gradient() when the gradient is needed.
+   *
+   * @param coordinates Coordinates to evaluate function and gradient at.
+   * @param gradient Matrix to store gradient into.
+   * @return Objective function.
+   */
+  double EvaluateWithGradient(const arma::mat& coordinates,
+                              arma::mat& gradient) const;
+
   /**
    * Get the initial point of the optimization (supplied by the
    * LagrangianFunction).
@@ -122,6 +138,17 @@ class AugLagrangianFunction
   double sigma;
 };
 
+/**
+ * AugLagrangianFunction always has an EvaluateWithGradient(), but it only
+ * saves work when the LagrangianFunction has its own; otherwise the optimizers
+ * are better off with separate calls to Evaluate() and Gradient().
+ */
+template<typename LagrangianFunction>
+struct HasEvaluateWithGradient<AugLagrangianFunction<LagrangianFunction> >
+{
+  static const bool value = HasEvaluateWithGradient<LagrangianFunction>::value;
+};
+
 }; // namespace optimization
 }; // namespace mlpack
 
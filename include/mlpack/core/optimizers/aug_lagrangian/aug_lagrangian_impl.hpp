@@ -113,11 +113,12 @@ bool AugLagrangian<LagrangianFunction>::Optimize(arma::mat& coordinates,
 
     // Check if we are done with the entire optimization (the threshold we are
     // comparing with is arbitrary).
-    if (std::abs(lastObjective - function.Evaluate(coordinates)) < 1e-10 &&
+    const double objective = function.Evaluate(coordinates);
+    if (std::abs(lastObjective - objective) < 1e-10 &&
         augfunc.Sigma() > 500000)
       return true;
 
-    lastObjective = function.Evaluate(coordinates);
+    lastObjective = objective;
 
     // Assuming that the optimization has converged to a new set of coordinates,
     // we now update either lambda or sigma.  We update sigma if the penalty
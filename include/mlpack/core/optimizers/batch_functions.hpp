@@ -0,0 +1,223 @@
+/**
+ * @file batch_functions.hpp
+ *
+ * Compile-time detection of the optional batch Evaluate(), Gradient() and
+ * EvaluateWithGradient() functions of decomposable functions, and helpers which
+ * call them when they are available.
+ *
+ * This file is part of MLPACK 1.0.10.
+ *
+ * MLPACK is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * MLPACK is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details (LICENSE.txt).
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * MLPACK.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __MLPACK_CORE_OPTIMIZERS_BATCH_FUNCTIONS_HPP
+#define __MLPACK_CORE_OPTIMIZERS_BATCH_FUNCTIONS_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/core/optimizers/evaluate_with_gradient.hpp>
+#include <boost/type_traits/remove_const.hpp>
+
+namespace mlpack {
+namespace optimization {
+
+/**
+ * Decomposable functions (as used by SGD and ParallelSumFunction) are summed
+ * over contiguous ranges of their functions.  In addition to
+ *
+ *   double Evaluate(const arma::mat& coordinates, const size_t i);
+ *   void Gradient(const arma::mat& coordinates,
+ *                 const size_t i,
+ *                 arma::mat& gradient);
+ *
+ * they may implement the batch functions
+ *
+ *   double Evaluate(const arma::mat& coordinates,
+ *                   const size_t begin,
+ *                   const size_t batchSize) const;
+ *   void Gradient(const arma::mat& coordinates,
+ *                 const size_t begin,
+ *                 const size_t batchSize,
+ *                 arma::mat& gradient) const;
+ *   double EvaluateWithGradient(const arma::mat& coordinates,
+ *                               const size_t begin,
+ *                               const size_t batchSize,
+ *                               arma::mat& gradient) const;
+ *
+ * which return the sum of the objective (or gradient) of the functions
+ * begin, ..., begin + batchSize - 1.  The optimizers call them through the
+ * helpers below, which sum the individual functions instead if the function
+ * does not have them.
+ */
+HAS_MEM_FUNC(Evaluate, HasBatchEvaluateSignature)
+HAS_MEM_FUNC(Gradient, HasBatchGradientSignature)
+HAS_MEM_FUNC(EvaluateWithGradient, HasBatchEvaluateWithGradientSignature)
+
+//! Whether FunctionType (which may be const) has a batch Evaluate().
+template<typename FunctionType>
+struct HasBatchEvaluate
+{
+  typedef typename boost::remove_const<FunctionType>::type F;
+
+  static const bool value = HasBatchEvaluateSignature<F,
+      double(F::*)(const arma::mat&, const size_t, const size_t) const>::value;
+};
+
+//! Whether FunctionType (which may be const) has a batch Gradient().
+template<typename FunctionType>
+struct HasBatchGradient
+{
+  typedef typename boost::remove_const<FunctionType>::type F;
+
+  static const bool value = HasBatchGradientSignature<F,
+      void(F::*)(const arma::mat&, const size_t, const size_t,
+      arma::mat&) const>::value;
+};
+
+//! Whether FunctionType (which may be const) has a batch
+//! EvaluateWithGradient().
+template<typename FunctionType>
+struct HasBatchEvaluateWithGradient
+{
+  typedef typename boost::remove_const<FunctionType>::type F;
+
+  static const bool value = HasBatchEvaluateWithGradientSignature<F,
+      double(F::*)(const arma::mat&, const size_t, const size_t,
+      arma::mat&) const>::value;
+};
+
+//! Evaluate the functions begin, ..., begin + count - 1 with the function's
+//! batch Evaluate().
+template<typename FunctionType>
+inline double BatchEvaluate(
+    FunctionType& function,
+    const arma::mat& coordinates,
+    const size_t begin,
+    const size_t count,
+    typename boost::enable_if_c<
+        HasBatchEvaluate<FunctionType>::value>::type* = 0)
+{
+  return function.Evaluate(coordinates, begin, count);
+}
+
+//! Evaluate the functions begin, ..., begin + count - 1 by summing each
+//! individual function.
+template<typename FunctionType>
+inline double BatchEvaluate(
+    FunctionType& function,
+    const arma::mat& coordinates,
+    const size_t begin,
+    const size_t count,
+    typename boost::disable_if_c<
+        HasBatchEvaluate<FunctionType>::value>::type* = 0)
+{
+  double objective = 0;
+  for (size_t i = begin; i < begin + count; ++i)
+    objective += function.Evaluate(coordinates, i);
+
+  return objective;
+}
+
+//! Compute the gradient of the functions begin, ..., begin + count - 1 with
+//! the function's batch Gradient().
+template<typename FunctionType>
+inline void BatchGradient(
+    FunctionType& function,
+    const arma::mat& coordinates,
+    const size_t begin,
+    const size_t count,
+    arma::mat& gradient,
+    typename boost::enable_if_c<
+        HasBatchGradient<FunctionType>::value>::type* = 0)
+{
+  function.Gradient(coordinates, begin, count, gradient);
+}
+
+//! Compute the gradient of the functions begin, ..., begin + count - 1 by
+//! summing the gradient of each individual function.
+template<typename FunctionType>
+inline void BatchGradient(
+    FunctionType& function,
+    const arma::mat& coordinates,
+    const size_t begin,
+    const size_t count,
+    arma::mat& gradient,
+    typename boost::disable_if_c<
+        HasBatchGradient<FunctionType>::value>::type* = 0)
+{
+  function.Gradient(coordinates, begin, gradient);
+
+  arma::mat functionGradient;
+  for (size_t i = begin + 1; i < begin + count; ++i)
+  {
+    function.Gradient(coordinates, i, functionGradient);
+    gradient += functionGradient;
+  }
+}
+
+//! Evaluate the objective and gradient of the functions begin, ...,
+//! begin + count - 1 with the function's batch EvaluateWithGradient().
+template<typename FunctionType>
+inline double BatchEvaluateWithGradient(
+    FunctionType& function,
+    const arma::mat& coordinates,
+    const size_t begin,
+    const size_t count,
+    arma::mat& gradient,
+    typename boost::enable_if_c<
+        HasBatchEvaluateWithGradient<FunctionType>::value>::type* = 0)
+{
+  return function.EvaluateWithGradient(coordinates, begin, count, gradient);
+}
+
+//! Evaluate the objective and gradient of the functions begin, ...,
+//! begin + count - 1 with the batch Evaluate() and Gradient() if the function
+//! has either of them, or function by function otherwise.
+template<typename FunctionType>
+inline double BatchEvaluateWithGradient(
+    FunctionType& function,
+    const arma::mat& coordinates,
+    const size_t begin,
+    const size_t count,
+    arma::mat& gradient,
+    typename boost::disable_if_c<
+        HasBatchEvaluateWithGradient<FunctionType>::value>::type* = 0)
+{
+  if (HasBatchEvaluate<FunctionType>::value ||
+      HasBatchGradient<FunctionType>::value)
+  {
+    const double objective = BatchEvaluate(function, coordinates, begin,
+        count);
+    BatchGradient(function, coordinates, begin, count, gradient);
+    return objective;
+  }
+
+  // Go function by function, so that each function's EvaluateWithGradient()
+  // can be used if it has one.
+  double objective = EvaluateWithGradient(function, coordinates, begin,
+      gradient);
+
+  arma::mat functionGradient;
+  for (size_t i = begin + 1; i < begin + count; ++i)
+  {
+    objective += EvaluateWithGradient(function, coordinates, i,
+        functionGradient);
+    gradient += functionGradient;
+  }
+
+  return objective;
+}
+
+}; // namespace optimization
+}; // namespace mlpack
+
+#endif
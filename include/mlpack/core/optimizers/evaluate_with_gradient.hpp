@@ -0,0 +1,142 @@
+/**
+ * @file evaluate_with_gradient.hpp
+ *
+ * Compile-time detection of the optional EvaluateWithGradient() function,
+ * which computes the objective and the gradient of a function at once, and
+ * helpers which call it when it is available.
+ *
+ * This file is part of MLPACK 1.0.10.
+ *
+ * MLPACK is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * MLPACK is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details (LICENSE.txt).
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * MLPACK.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __MLPACK_CORE_OPTIMIZERS_EVALUATE_WITH_GRADIENT_HPP
+#define __MLPACK_CORE_OPTIMIZERS_EVALUATE_WITH_GRADIENT_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace optimization {
+
+/**
+ * Many objective functions share most of the work between Evaluate() and
+ * Gradient() (for instance, a forward pass over the data).  Such functions may
+ * implement, in addition to
+ *
+ *   double Evaluate(const arma::mat& coordinates);
+ *   void Gradient(const arma::mat& coordinates, arma::mat& gradient);
+ *
+ * the function
+ *
+ *   double EvaluateWithGradient(const arma::mat& coordinates,
+ *                               arma::mat& gradient);
+ *
+ * which stores the gradient in the given matrix and returns the objective.
+ * Decomposable functions (as used by SGD) may similarly implement
+ *
+ *   double EvaluateWithGradient(const arma::mat& coordinates,
+ *                               const size_t i,
+ *                               arma::mat& gradient);
+ *
+ * Either may be const or not.  The optimizers call EvaluateWithGradient()
+ * through the helpers below, which fall back to separate calls to Evaluate()
+ * and Gradient() if the function does not have it.
+ */
+HAS_MEM_FUNC(EvaluateWithGradient, HasEvaluateWithGradientSignature)
+
+//! Whether FunctionType has a (const or non-const) EvaluateWithGradient() on
+//! the whole objective.
+template<typename FunctionType>
+struct HasEvaluateWithGradient
+{
+  static const bool value = HasEvaluateWithGradientSignature<FunctionType,
+      double(FunctionType::*)(const arma::mat&, arma::mat&)>::value ||
+      HasEvaluateWithGradientSignature<FunctionType,
+      double(FunctionType::*)(const arma::mat&, arma::mat&) const>::value;
+};
+
+//! Whether FunctionType has a (const or non-const) EvaluateWithGradient() on a
+//! single one of its decomposed functions.
+template<typename FunctionType>
+struct HasDecomposableEvaluateWithGradient
+{
+  static const bool value = HasEvaluateWithGradientSignature<FunctionType,
+      double(FunctionType::*)(const arma::mat&, const size_t,
+      arma::mat&)>::value ||
+      HasEvaluateWithGradientSignature<FunctionType,
+      double(FunctionType::*)(const arma::mat&, const size_t,
+      arma::mat&) const>::value;
+};
+
+//! Evaluate the objective and gradient with the function's
+//! EvaluateWithGradient().
+template<typename FunctionType>
+inline double EvaluateWithGradient(
+    FunctionType& function,
+    const arma::mat& coordinates,
+    arma::mat& gradient,
+    typename boost::enable_if_c<
+        HasEvaluateWithGradient<FunctionType>::value>::type* = 0)
+{
+  return function.EvaluateWithGradient(coordinates, gradient);
+}
+
+//! Evaluate the objective and gradient with separate calls to the function's
+//! Evaluate() and Gradient().
+template<typename FunctionType>
+inline double EvaluateWithGradient(
+    FunctionType& function,
+    const arma::mat& coordinates,
+    arma::mat& gradient,
+    typename boost::disable_if_c<
+        HasEvaluateWithGradient<FunctionType>::value>::type* = 0)
+{
+  const double objective = function.Evaluate(coordinates);
+  function.Gradient(coordinates, gradient);
+  return objective;
+}
+
+//! Evaluate the objective and gradient of the i'th decomposed function with
+//! the function's EvaluateWithGradient().
+template<typename FunctionType>
+inline double EvaluateWithGradient(
+    FunctionType& function,
+    const arma::mat& coordinates,
+    const size_t i,
+    arma::mat& gradient,
+    typename boost::enable_if_c<
+        HasDecomposableEvaluateWithGradient<FunctionType>::value>::type* = 0)
+{
+  return function.EvaluateWithGradient(coordinates, i, gradient);
+}
+
+//! Evaluate the objective and gradient of the i'th decomposed function with
+//! separate calls to the function's Evaluate() and Gradient().
+template<typename FunctionType>
+inline double EvaluateWithGradient(
+    FunctionType& function,
+    const arma::mat& coordinates,
+    const size_t i,
+    arma::mat& gradient,
+    typename boost::disable_if_c<
+        HasDecomposableEvaluateWithGradient<FunctionType>::value>::type* = 0)
+{
+  const double objective = function.Evaluate(coordinates, i);
+  function.Gradient(coordinates, i, gradient);
+  return objective;
+}
+
+}; // namespace optimization
+}; // namespace mlpack
+
+#endif
@@ -24,6 +24,7 @@
 #define __MLPACK_CORE_OPTIMIZERS_LBFGS_LBFGS_HPP
 
 #include <mlpack/core.hpp>
+#include <mlpack/core/optimizers/evaluate_with_gradient.hpp>
 
 namespace mlpack {
 namespace optimization {
@@ -39,6 +40,18 @@ namespace optimization {
  *  - double Evaluate(const arma::mat& coordinates);
  *  - void Gradient(const arma::mat& coordinates, arma::mat& gradient);
  *  - arma::mat& GetInitialPoint();
+ *
+ * If the function also implements
+ *
+ *  - double EvaluateWithGradient(const arma::mat& coordinates,
+ *                                arma::mat& gradient);
+ *
+ * then it is used to compute the objective and gradient together (see
+ * evaluate_with_gradient.hpp).  Each iteration evaluates the function and its
+ * gradient once per line search trial (without EvaluateWithGradient(), the
+ * gradient only for trials that satisfy the Armijo condition), and never more
+ * than that.  If the objective is a sum over a dataset, wrapping it
+ * in a ParallelSumFunction lets these evaluations use every core.
  */
 template<typename FunctionType>
 class L_BFGS
@@ -163,6 +176,8 @@ class L_BFGS
 
   //! Position of the new iterate.
   arma::mat newIterateTmp;
+  //! Gradient at the new iterate.
+  arma::mat newGradientTmp;
   //! Stores all the s matrices in memory.
   arma::cube s;
   //! Stores all the y matrices in memory.
@@ -196,6 +211,14 @@ class L_BFGS
    */
   double Evaluate(const arma::mat& iterate);
 
+  /**
+   * Evaluate the function and its gradient at the given iterate point, and
+   * store the result if it is a new minimum.
+   *
+   * @return The value of the function.
+   */
+  double EvaluateWithGradient(const arma::mat& iterate, arma::mat& gradient);
+
   /**
    * Calculate the scaling factor, gamma, which is used to scale the Hessian
    * approximation matrix.  See method M3 in Section 4 of Liu and Nocedal
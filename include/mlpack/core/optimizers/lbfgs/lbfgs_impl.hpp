@@ -69,6 +69,7 @@ L_BFGS<FunctionType>::L_BFGS(FunctionType& function,
   const size_t cols = function.GetInitialPoint().n_cols;
 
   newIterateTmp.set_size(rows, cols);
+  newGradientTmp.set_size(rows, cols);
   s.set_size(rows, cols, numBasis);
   y.set_size(rows, cols, numBasis);
 
@@ -99,6 +100,29 @@ double L_BFGS<FunctionType>::Evaluate(const arma::mat& iterate)
   return functionValue;
 }
 
+/**
+ * Evaluate the function and its gradient at the given iterate point, with the
+ * function's EvaluateWithGradient() if it has one, and store the result if it
+ * is a new minimum.
+ *
+ * @return The value of the function
+ */
+template<typename FunctionType>
+double L_BFGS<FunctionType>::EvaluateWithGradient(const arma::mat& iterate,
+                                                  arma::mat& gradient)
+{
+  double functionValue = optimization::EvaluateWithGradient(function, iterate,
+      gradient);
+
+  if (functionValue < minPointIterate.second)
+  {
+    minPointIterate.first = iterate;
+    minPointIterate.second = functionValue;
+  }
+
+  return functionValue;
+}
+
 /**
  * Calculate the scaling factor gamma which is used to scale the Hessian
  * approximation matrix.  See method M3 in Section 4 of Liu and Nocedal (1989).
@@ -142,11 +166,18 @@ bool L_BFGS<FunctionType>::GradientNormTooSmall(const arma::mat& gradient)
 
 /**
  * Perform a back-tracking line search along the search direction to calculate a
- * step size satisfying the Wolfe conditions.
+ * step size satisfying the Wolfe conditions.  Unless the function has an
+ * EvaluateWithGradient() (in which case both are computed together), the
+ * gradient at a trial point is only computed if the point satisfies the Armijo
+ * condition.  The function value and gradient of the accepted point are handed
+ * back to the caller, so that they never need to be computed again.  If the
+ * search fails, the iterate, function value and gradient are left untouched.
  *
- * @param functionValue Value of the function at the initial point
+ * @param functionValue Value of the function at the initial point (will be
+ *     set to the value at the new point)
  * @param iterate The initial point to begin the line search from
- * @param gradient The gradient at the initial point
+ * @param gradient The gradient at the initial point (will be set to the
+ *     gradient at the new point)
  * @param searchDirection A vector specifying the search direction
  * @param stepSize Variable the calculated step size will be stored in
  *
@@ -189,25 +220,30 @@ bool L_BFGS<FunctionType>::LineSearch(double& functionValue,
   const double dec = 0.5;
   double width = 0;
 
+  double newFunctionValue;
   while (true)
   {
-    // Perform a step and evaluate the gradient and the function values at that
-    // point.
+    // Perform a step and evaluate the function value at that point.
     newIterateTmp = iterate;
     newIterateTmp += stepSize * searchDirection;
-    functionValue = Evaluate(newIterateTmp);
-    function.Gradient(newIterateTmp, gradient);
+    if (HasEvaluateWithGradient<FunctionType>::value)
+      newFunctionValue = EvaluateWithGradient(newIterateTmp, newGradientTmp);
+    else
+      newFunctionValue = Evaluate(newIterateTmp);
     numIterations++;
 
-    if (functionValue > initialFunctionValue + stepSize *
+    if (newFunctionValue > initialFunctionValue + stepSize *
         linearApproxFunctionValueDecrease)
     {
       width = dec;
     }
     else
     {
-      // Check Wolfe's condition.
-      double searchDirectionDotGradient = arma::dot(gradient, searchDirection);
+      // The gradient is only needed to check Wolfe's condition.
+      if (!HasEvaluateWithGradient<FunctionType>::value)
+        function.Gradient(newIterateTmp, newGradientTmp);
+      double searchDirectionDotGradient = arma::dot(newGradientTmp,
+          searchDirection);
 
       if (searchDirectionDotGradient < wolfe *
           initialSearchDirectionDotGradient)
@@ -242,6 +278,8 @@ bool L_BFGS<FunctionType>::LineSearch(double& functionValue,
 
   // Move to the new iterate.
   iterate = newIterateTmp;
+  functionValue = newFunctionValue;
+  gradient = newGradientTmp;
   return true;
 }
 
@@ -368,9 +406,6 @@ double L_BFGS<FunctionType>::Optimize(arma::mat& iterate,
   // Whether to optimize until convergence.
   bool optimizeUntilConvergence = (maxIterations == 0);
 
-  // The initial function value.
-  double functionValue = Evaluate(iterate);
-
   // The gradient: the current and the old.
   arma::mat gradient;
   arma::mat oldGradient;
@@ -381,15 +416,15 @@ double L_BFGS<FunctionType>::Optimize(arma::mat& iterate,
   arma::mat searchDirection;
   searchDirection.zeros(iterate.n_rows, iterate.n_cols);
 
-  // The initial gradient value.
-  function.Gradient(iterate, gradient);
+  // The initial function value and gradient.
+  double functionValue = EvaluateWithGradient(iterate, gradient);
 
   // The main optimization loop.
   for (size_t itNum = 0; optimizeUntilConvergence || (itNum != maxIterations);
        ++itNum)
   {
     Log::Debug << "L-BFGS iteration " << itNum << "; objective " <<
-        function.Evaluate(iterate) << "." << std::endl;
+        functionValue << "." << std::endl;
 
     // Break when the norm of the gradient becomes too small.
     if (GradientNormTooSmall(gradient))
@@ -431,7 +466,8 @@ double L_BFGS<FunctionType>::Optimize(arma::mat& iterate,
 
   } // End of the optimization loop.
 
-  return function.Evaluate(iterate);
+  // The line search keeps functionValue up to date with the iterate.
+  return functionValue;
 }
 
 // Convert the object to a string.
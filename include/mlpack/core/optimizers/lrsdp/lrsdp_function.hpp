@@ -111,6 +111,22 @@ class LRSDPFunction
   arma::uvec aModes;
 };
 
+// The augmented Lagrangian of an LRSDP is specialized for efficiency; these
+// specializations are defined in lrsdp_function.cpp.
+template<>
+double AugLagrangianFunction<LRSDPFunction>::Evaluate(
+    const arma::mat& coordinates) const;
+
+template<>
+void AugLagrangianFunction<LRSDPFunction>::Gradient(
+    const arma::mat& coordinates,
+    arma::mat& gradient) const;
+
+// LRSDPFunction has no EvaluateWithGradient(), so the optimizers do not use
+// the generic AugLagrangianFunction::EvaluateWithGradient() (see
+// HasEvaluateWithGradient in aug_lagrangian_function.hpp), and only call the
+// specialized Gradient() when the gradient is needed.
+
 };
 };
 
@@ -0,0 +1,225 @@
+/**
+ * @file parallel_sgd.hpp
+ *
+ * Asynchronous, lock-free parallel stochastic gradient descent (Hogwild!).
+ *
+ * This file is part of MLPACK 1.0.10.
+ *
+ * MLPACK is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * MLPACK is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details (LICENSE.txt).
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * MLPACK.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __MLPACK_CORE_OPTIMIZERS_PARALLEL_SGD_PARALLEL_SGD_HPP
+#define __MLPACK_CORE_OPTIMIZERS_PARALLEL_SGD_PARALLEL_SGD_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace optimization {
+
+/**
+ * An asynchronous parallel implementation of stochastic gradient descent, in
+ * the style of Hogwild! (Niu et al., 2011).  Like SGD (see
+ * mlpack::optimization::SGD), this minimizes a function which can be expressed
+ * as a sum of other functions,
+ *
+ * \f[
+ * f(A) = \sum_{i = 0}^{n} f_i(A),
+ * \f]
+ *
+ * but each thread takes steps \f$ A \leftarrow A - \alpha \nabla f_i(A) \f$
+ * for its own share of the functions, directly on the shared iterate and
+ * without any locking.  When the gradient of each \f$ f_i(A) \f$ only touches
+ * a few elements of \f$ A \f$ (as in matrix factorization, where each rating
+ * only affects one user vector and one item vector), the threads rarely
+ * overwrite each other's updates and the algorithm converges much like serial
+ * SGD does, while scaling nearly linearly with the number of threads.
+ *
+ * The algorithm makes passes over the functions (in a random order if shuffle
+ * is true) until maxIterations updates have been taken, or until the objective
+ * of a pass improves by less than the given tolerance.  The objective of a pass
+ * is the sum of the objective of each function, as evaluated just before the
+ * update taken with it.
+ *
+ * For ParallelSGD to work, a DecomposableFunctionType template parameter is
+ * required.  This class must implement the following functions:
+ *
+ *   size_t NumFunctions() const;
+ *   double Evaluate(const arma::mat& coordinates, const size_t i) const;
+ *   void Gradient(const arma::mat& coordinates,
+ *                 const size_t i,
+ *                 arma::mat& gradient) const;
+ *
+ * These are the same functions that SGD requires, but they are called by many
+ * threads at once, so they must be const and safe to call concurrently.  To
+ * avoid computing a dense gradient for each update, the class may optionally
+ * also implement
+ *
+ *   void UpdateIterate(arma::mat& coordinates,
+ *                      const size_t i,
+ *                      const double stepSize) const;
+ *
+ * which should perform the update
+ * coordinates -= stepSize * gradient(coordinates, i) in place, touching only
+ * the elements of the coordinates on which the gradient of the i'th function
+ * is nonzero.  If UpdateIterate() is not available, the gradient from
+ * Gradient() is computed into a per-thread matrix and only its nonzero elements
+ * are written to the iterate.  Functions whose objective and update share most
+ * of their work may instead implement
+ *
+ *   double EvaluateAndUpdate(arma::mat& coordinates,
+ *                            const size_t i,
+ *                            const double stepSize) const;
+ *
+ * which returns Evaluate(coordinates, i) (before the update) and then performs
+ * the same update as UpdateIterate(); each step then makes one call to the
+ * function instead of two.
+ *
+ * If mlpack is compiled without OpenMP support, this is simply serial SGD.
+ *
+ * @tparam DecomposableFunctionType Decomposable objective function type to be
+ *     minimized.
+ */
+template<typename DecomposableFunctionType>
+class ParallelSGD
+{
+ public:
+  /**
+   * Construct the ParallelSGD optimizer with the given function and
+   * parameters.
+   *
+   * @param function Function to be optimized (minimized).
+   * @param stepSize Step size for each update.
+   * @param maxIterations Maximum number of updates allowed, over all threads
+   *     (0 means no limit).
+   * @param tolerance Maximum absolute tolerance to terminate algorithm.
+   * @param shuffle If true, the function order is shuffled on every pass;
+   *     otherwise, each function is visited in linear order.
+   */
+  ParallelSGD(DecomposableFunctionType& function,
+              const double stepSize = 0.01,
+              const size_t maxIterations = 100000,
+              const double tolerance = 1e-5,
+              const bool shuffle = true);
+
+  /**
+   * Optimize the given function using asynchronous parallel stochastic
+   * gradient descent.  The given starting point will be modified to store the
+   * finishing point of the algorithm, and the final objective value is
+   * returned.
+   *
+   * @param iterate Starting point (will be modified).
+   * @return Objective value of the final pass over the functions.
+   */
+  double Optimize(arma::mat& iterate);
+
+  //! Get the instantiated function to be optimized.
+  const DecomposableFunctionType& Function() const { return function; }
+  //! Modify the instantiated function.
+  DecomposableFunctionType& Function() { return function; }
+
+  //! Get the step size.
+  double StepSize() const { return stepSize; }
+  //! Modify the step size.
+  double& StepSize() { return stepSize; }
+
+  //! Get the maximum number of updates (0 indicates no limit).
+  size_t MaxIterations() const { return maxIterations; }
+  //! Modify the maximum number of updates (0 indicates no limit).
+  size_t& MaxIterations() { return maxIterations; }
+
+  //! Get the tolerance for termination.
+  double Tolerance() const { return tolerance; }
+  //! Modify the tolerance for termination.
+  double& Tolerance() { return tolerance; }
+
+  //! Get whether or not the individual functions are shuffled.
+  bool Shuffle() const { return shuffle; }
+  //! Modify whether or not the individual functions are shuffled.
+  bool& Shuffle() { return shuffle; }
+
+  // Convert the object into a string.
+  std::string ToString() const;
+
+ private:
+  //! The instantiated function.
+  DecomposableFunctionType& function;
+
+  //! The step size for each update.
+  double stepSize;
+
+  //! The maximum number of allowed updates.
+  size_t maxIterations;
+
+  //! The tolerance for termination.
+  double tolerance;
+
+  //! Controls whether or not the individual functions are shuffled when
+  //! iterating.
+  bool shuffle;
+
+  //! Check for the fused in-place EvaluateAndUpdate() function.
+  HAS_MEM_FUNC(EvaluateAndUpdate, HasEvaluateAndUpdate)
+
+  //! Evaluate the i'th function and update the iterate in place, with the
+  //! function's EvaluateAndUpdate().
+  template<typename FunctionType>
+  double Step(const FunctionType& f,
+              arma::mat& iterate,
+              const size_t i,
+              arma::mat& gradient,
+              typename boost::enable_if<HasEvaluateAndUpdate<FunctionType,
+                  double(FunctionType::*)(arma::mat&, const size_t,
+                  const double) const> >::type* = 0);
+
+  //! Evaluate the i'th function with Evaluate(), then update the iterate.
+  template<typename FunctionType>
+  double Step(const FunctionType& f,
+              arma::mat& iterate,
+              const size_t i,
+              arma::mat& gradient,
+              typename boost::disable_if<HasEvaluateAndUpdate<FunctionType,
+                  double(FunctionType::*)(arma::mat&, const size_t,
+                  const double) const> >::type* = 0);
+
+  //! Check for the in-place UpdateIterate() function.
+  HAS_MEM_FUNC(UpdateIterate, HasUpdateIterate)
+
+  //! Update the iterate in place with the function's UpdateIterate().
+  template<typename FunctionType>
+  void UpdateIterate(const FunctionType& f,
+                     arma::mat& iterate,
+                     const size_t i,
+                     arma::mat& gradient,
+                     typename boost::enable_if<HasUpdateIterate<FunctionType,
+                         void(FunctionType::*)(arma::mat&, const size_t,
+                         const double) const> >::type* = 0);
+
+  //! Update the iterate by computing the gradient with Gradient() and writing
+  //! its nonzero elements to the iterate.
+  template<typename FunctionType>
+  void UpdateIterate(const FunctionType& f,
+                     arma::mat& iterate,
+                     const size_t i,
+                     arma::mat& gradient,
+                     typename boost::disable_if<HasUpdateIterate<FunctionType,
+                         void(FunctionType::*)(arma::mat&, const size_t,
+                         const double) const> >::type* = 0);
+};
+
+}; // namespace optimization
+}; // namespace mlpack
+
+// Include implementation.
+#include "parallel_sgd_impl.hpp"
+
+#endif
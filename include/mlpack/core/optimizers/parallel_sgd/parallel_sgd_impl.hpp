@@ -0,0 +1,198 @@
+/**
+ * @file parallel_sgd_impl.hpp
+ *
+ * Implementation of asynchronous, lock-free parallel stochastic gradient
+ * descent.
+ *
+ * This file is part of MLPACK 1.0.10.
+ *
+ * MLPACK is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * MLPACK is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details (LICENSE.txt).
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * MLPACK.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __MLPACK_CORE_OPTIMIZERS_PARALLEL_SGD_PARALLEL_SGD_IMPL_HPP
+#define __MLPACK_CORE_OPTIMIZERS_PARALLEL_SGD_PARALLEL_SGD_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "parallel_sgd.hpp"
+
+namespace mlpack {
+namespace optimization {
+
+template<typename DecomposableFunctionType>
+ParallelSGD<DecomposableFunctionType>::ParallelSGD(
+    DecomposableFunctionType& function,
+    const double stepSize,
+    const size_t maxIterations,
+    const double tolerance,
+    const bool shuffle) :
+    function(function),
+    stepSize(stepSize),
+    maxIterations(maxIterations),
+    tolerance(tolerance),
+    shuffle(shuffle)
+{ /* Nothing to do. */ }
+
+//! Optimize the function (minimize).
+template<typename DecomposableFunctionType>
+double ParallelSGD<DecomposableFunctionType>::Optimize(arma::mat& iterate)
+{
+  // The threads only get const access to the function.
+  const DecomposableFunctionType& f = function;
+  const size_t numFunctions = f.NumFunctions();
+
+  arma::Col<size_t> visitationOrder(numFunctions);
+  for (size_t i = 0; i < numFunctions; ++i)
+    visitationOrder[i] = i;
+
+  size_t iterations = 0;
+  double overallObjective = 0;
+  double lastObjective = DBL_MAX;
+
+  while (maxIterations == 0 || iterations < maxIterations)
+  {
+    // The last pass may be cut short by the maximum number of iterations.
+    const size_t passSize = (maxIterations == 0) ? numFunctions :
+        std::min(numFunctions, maxIterations - iterations);
+
+    if (shuffle) // Determine order of visitation.
+      visitationOrder = arma::shuffle(visitationOrder);
+
+    // Each thread updates the shared iterate with no locking at all.
+    overallObjective = 0;
+    #pragma omp parallel
+    {
+      arma::mat gradient;
+
+      #pragma omp for reduction(+:overallObjective) schedule(static)
+      for (size_t j = 0; j < passSize; ++j)
+      {
+        overallObjective += Step(f, iterate, visitationOrder[j], gradient);
+      }
+    }
+    iterations += passSize;
+
+    // The objective of a partial pass can't be compared with the last pass.
+    if (passSize < numFunctions)
+      break;
+
+    // Output current objective function.
+    Log::Info << "ParallelSGD: iteration " << iterations << ", objective "
+        << overallObjective << "." << std::endl;
+
+    if (overallObjective != overallObjective)
+    {
+      Log::Warn << "ParallelSGD: converged to " << overallObjective << "; "
+          << "terminating with failure.  Try a smaller step size?"
+          << std::endl;
+      return overallObjective;
+    }
+
+    if (std::abs(lastObjective - overallObjective) < tolerance)
+    {
+      Log::Info << "ParallelSGD: minimized within tolerance " << tolerance
+          << "; terminating optimization." << std::endl;
+      return overallObjective;
+    }
+
+    lastObjective = overallObjective;
+  }
+
+  Log::Info << "ParallelSGD: maximum iterations (" << maxIterations << ") "
+      << "reached; terminating optimization." << std::endl;
+  return overallObjective;
+}
+
+template<typename DecomposableFunctionType>
+template<typename FunctionType>
+double ParallelSGD<DecomposableFunctionType>::Step(
+    const FunctionType& f,
+    arma::mat& iterate,
+    const size_t i,
+    arma::mat& /* gradient */,
+    typename boost::enable_if<HasEvaluateAndUpdate<FunctionType,
+        double(FunctionType::*)(arma::mat&, const size_t,
+        const double) const> >::type*)
+{
+  return f.EvaluateAndUpdate(iterate, i, stepSize);
+}
+
+template<typename DecomposableFunctionType>
+template<typename FunctionType>
+double ParallelSGD<DecomposableFunctionType>::Step(
+    const FunctionType& f,
+    arma::mat& iterate,
+    const size_t i,
+    arma::mat& gradient,
+    typename boost::disable_if<HasEvaluateAndUpdate<FunctionType,
+        double(FunctionType::*)(arma::mat&, const size_t,
+        const double) const> >::type*)
+{
+  const double objective = f.Evaluate(iterate, i);
+  UpdateIterate(f, iterate, i, gradient);
+  return objective;
+}
+
+template<typename DecomposableFunctionType>
+template<typename FunctionType>
+void ParallelSGD<DecomposableFunctionType>::UpdateIterate(
+    const FunctionType& f,
+    arma::mat& iterate,
+    const size_t i,
+    arma::mat& /* gradient */,
+    typename boost::enable_if<HasUpdateIterate<FunctionType,
+        void(FunctionType::*)(arma::mat&, const size_t,
+        const double) const> >::type*)
+{
+  f.UpdateIterate(iterate, i, stepSize);
+}
+
+template<typename DecomposableFunctionType>
+template<typename FunctionType>
+void ParallelSGD<DecomposableFunctionType>::UpdateIterate(
+    const FunctionType& f,
+    arma::mat& iterate,
+    const size_t i,
+    arma::mat& gradient,
+    typename boost::disable_if<HasUpdateIterate<FunctionType,
+        void(FunctionType::*)(arma::mat&, const size_t,
+        const double) const> >::type*)
+{
+  f.Gradient(iterate, i, gradient);
+
+  // Only write the elements that actually change, so that threads working on
+  // functions with disjoint support don't interfere with each other.
+  for (size_t k = 0; k < gradient.n_elem; ++k)
+    if (gradient[k] != 0.0)
+      iterate[k] -= stepSize * gradient[k];
+}
+
+// Convert the object to a string.
+template<typename DecomposableFunctionType>
+std::string ParallelSGD<DecomposableFunctionType>::ToString() const
+{
+  std::ostringstream convert;
+  convert << "ParallelSGD [" << this << "]" << std::endl;
+  convert << "  Function:" << std::endl;
+  convert << util::Indent(function.ToString(), 2);
+  convert << "  Step size: " << stepSize << std::endl;
+  convert << "  Maximum iterations: " << maxIterations << std::endl;
+  convert << "  Tolerance: " << tolerance << std::endl;
+  convert << "  Shuffle points: " << (shuffle ? "true" : "false") << std::endl;
+  convert << "  Threads: " << omp_get_max_threads() << std::endl;
+  return convert.str();
+}
+
+}; // namespace optimization
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,190 @@
+/**
+ * @file parallel_sum_function.hpp
+ *
+ * An adapter which evaluates the objective and gradient of a decomposable
+ * function as a parallel sum over shards of its functions.
+ *
+ * This file is part of MLPACK 1.0.10.
+ *
+ * MLPACK is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * MLPACK is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details (LICENSE.txt).
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * MLPACK.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __MLPACK_CORE_OPTIMIZERS_PARALLEL_SUM_PARALLEL_SUM_FUNCTION_HPP
+#define __MLPACK_CORE_OPTIMIZERS_PARALLEL_SUM_PARALLEL_SUM_FUNCTION_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/core/optimizers/batch_functions.hpp>
+
+namespace mlpack {
+namespace optimization {
+
+/**
+ * ParallelSumFunction turns a decomposable function (one which can be
+ * expressed as a sum of other functions, as used by SGD) into a function with
+ * a full Evaluate() and Gradient(), which are computed by splitting the
+ * functions into contiguous shards, evaluating the shards in parallel with
+ * OpenMP, and summing the results.  This lets full-batch optimizers such as
+ * L_BFGS use every core when the objective is a sum over a large dataset:
+ *
+ * @code
+ * LogisticRegressionFunction f(predictors, responses, lambda);
+ * ParallelSumFunction<LogisticRegressionFunction> parallelF(f);
+ * L_BFGS<ParallelSumFunction<LogisticRegressionFunction> > lbfgs(parallelF);
+ * arma::mat parameters = f.GetInitialPoint();
+ * lbfgs.Optimize(parameters);
+ * @endcode
+ *
+ * The DecomposableFunctionType template parameter must implement
+ *
+ *   size_t NumFunctions() const;
+ *   const arma::mat& GetInitialPoint() const;
+ *   double Evaluate(const arma::mat& coordinates, const size_t i) const;
+ *   void Gradient(const arma::mat& coordinates,
+ *                 const size_t i,
+ *                 arma::mat& gradient) const;
+ *
+ * and, if available, the batch overloads
+ *
+ *   double Evaluate(const arma::mat& coordinates,
+ *                   const size_t begin,
+ *                   const size_t batchSize) const;
+ *   void Gradient(const arma::mat& coordinates,
+ *                 const size_t begin,
+ *                 const size_t batchSize,
+ *                 arma::mat& gradient) const;
+ *
+ * are used to evaluate each shard (see batch_functions.hpp); otherwise the
+ * individual functions of each shard are summed.  All of these are called from
+ * several threads at once, so they must be const and safe to call
+ * concurrently.  The shards are always summed in the same order, so the results
+ * do not depend on how the threads are scheduled.
+ *
+ * @tparam DecomposableFunctionType Decomposable function type to wrap.
+ */
+template<typename DecomposableFunctionType>
+class ParallelSumFunction
+{
+ public:
+  /**
+   * Wrap the given decomposable function.
+   *
+   * @param function Function to wrap.
+   * @param shards Number of shards to split the functions into (0 means one
+   *     shard per OpenMP thread).
+   */
+  ParallelSumFunction(const DecomposableFunctionType& function,
+                      const size_t shards = 0) :
+      function(function),
+      shards(shards)
+  { /* Nothing to do. */ }
+
+  /**
+   * Evaluate the sum of all of the functions at the given coordinates.
+   *
+   * @param coordinates Point at which to evaluate.
+   */
+  double Evaluate(const arma::mat& coordinates) const
+  {
+    const size_t numShards = NumShards();
+
+    arma::vec shardObjectives(numShards);
+    #pragma omp parallel for schedule(static) if (numShards > 1)
+    for (size_t shard = 0; shard < numShards; ++shard)
+    {
+      shardObjectives[shard] = BatchEvaluate(function, coordinates,
+          ShardBegin(shard, numShards), ShardBegin(shard + 1, numShards) -
+          ShardBegin(shard, numShards));
+    }
+
+    return arma::accu(shardObjectives);
+  }
+
+  /**
+   * Evaluate the gradient of the sum of all of the functions at the given
+   * coordinates.
+   *
+   * @param coordinates Point at which to evaluate the gradient.
+   * @param gradient Matrix to store the gradient in.
+   */
+  void Gradient(const arma::mat& coordinates, arma::mat& gradient) const
+  {
+    const size_t numShards = NumShards();
+
+    std::vector<arma::mat> shardGradients(numShards);
+    #pragma omp parallel for schedule(static) if (numShards > 1)
+    for (size_t shard = 0; shard < numShards; ++shard)
+    {
+      BatchGradient(function, coordinates, ShardBegin(shard, numShards),
+          ShardBegin(shard + 1, numShards) - ShardBegin(shard, numShards),
+          shardGradients[shard]);
+    }
+
+    gradient = shardGradients[0];
+    for (size_t shard = 1; shard < numShards; ++shard)
+      gradient += shardGradients[shard];
+  }
+
+  //! Return the initial point of the wrapped function.
+  const arma::mat& GetInitialPoint() const
+  { return function.GetInitialPoint(); }
+
+  //! Return the number of functions in the sum.
+  size_t NumFunctions() const { return function.NumFunctions(); }
+
+  //! Return the wrapped function.
+  const DecomposableFunctionType& Function() const { return function; }
+
+  //! Get the number of shards (0 means one per OpenMP thread).
+  size_t Shards() const { return shards; }
+  //! Modify the number of shards (0 means one per OpenMP thread).
+  size_t& Shards() { return shards; }
+
+  // Convert the object into a string.
+  std::string ToString() const
+  {
+    std::ostringstream convert;
+    convert << "ParallelSumFunction [" << this << "]" << std::endl;
+    convert << "  Function:" << std::endl;
+    convert << util::Indent(function.ToString(), 2);
+    convert << "  Shards: " << NumShards() << std::endl;
+    return convert.str();
+  }
+
+ private:
+  //! The wrapped function.
+  const DecomposableFunctionType& function;
+
+  //! The number of shards (0 means one per OpenMP thread).
+  size_t shards;
+
+  //! Return the number of shards to use; never more than the number of
+  //! functions, and never 0.
+  size_t NumShards() const
+  {
+    const size_t numShards = (shards == 0) ? (size_t) omp_get_max_threads() :
+        shards;
+    return std::max((size_t) 1, std::min(numShards,
+        function.NumFunctions()));
+  }
+
+  //! Return the first function of the given shard.
+  size_t ShardBegin(const size_t shard, const size_t numShards) const
+  {
+    return (shard * function.NumFunctions()) / numShards;
+  }
+};
+
+}; // namespace optimization
+}; // namespace mlpack
+
+#endif
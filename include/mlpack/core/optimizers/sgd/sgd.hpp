@@ -23,6 +23,7 @@
 #define __MLPACK_CORE_OPTIMIZERS_SGD_SGD_HPP
 
 #include <mlpack/core.hpp>
+#include <mlpack/core/optimizers/batch_functions.hpp>
 
 namespace mlpack {
 namespace optimization {
@@ -79,6 +80,45 @@ namespace optimization {
  * objective function on the first point in the dataset (presumably, the dataset
  * is held internally in the DecomposableFunctionType).
  *
+ * SGD can also take mini-batches of functions at each step, by setting the
+ * batchSize parameter.  The gradient of each mini-batch is split into shards
+ * which are evaluated in parallel (if mlpack is compiled with OpenMP support),
+ * and the iterate is then updated with the average gradient of the mini-batch.
+ * The mini-batches are contiguous ranges of function indices, so
+ * DecomposableFunctionType may optionally also implement
+ *
+ *   double Evaluate(const arma::mat& coordinates,
+ *                   const size_t begin,
+ *                   const size_t batchSize) const;
+ *   void Gradient(const arma::mat& coordinates,
+ *                 const size_t begin,
+ *                 const size_t batchSize,
+ *                 arma::mat& gradient) const;
+ *
+ * which return the sum of the objective (or gradient) of the functions
+ * begin, ..., begin + batchSize - 1, or
+ *
+ *   double EvaluateWithGradient(const arma::mat& coordinates,
+ *                               const size_t begin,
+ *                               const size_t batchSize,
+ *                               arma::mat& gradient) const;
+ *
+ * which computes both at once.  If these are not available, the individual
+ * functions are summed instead, using EvaluateWithGradient(coordinates, i,
+ * gradient) for each one if the function has it (see batch_functions.hpp and
+ * evaluate_with_gradient.hpp).  When the batch size is greater than 1, shards
+ * are evaluated at the same time, so these functions must then be safe to call
+ * concurrently.  A batch size of 1 gives standard SGD.
+ *
+ * The objective of some functions is not a sum over the points of the
+ * mini-batch (for instance, it may depend on averages over the mini-batch), so
+ * it cannot be split into shards.  Such a function can implement
+ *
+ *   bool ShardBatches() const;
+ *
+ * and return false; then each mini-batch is evaluated with a single call, and
+ * the function is expected to parallelize that call itself.
+ *
  * @tparam DecomposableFunctionType Decomposable objective function type to be
  *     minimized.
  */
@@ -96,12 +136,15 @@ class SGD
    * @param tolerance Maximum absolute tolerance to terminate algorithm.
    * @param shuffle If true, the function order is shuffled; otherwise, each
    *     function is visited in linear order.
+   * @param batchSize Number of functions in each mini-batch; each iteration
+   *     takes one step using a single mini-batch.
    */
   SGD(DecomposableFunctionType& function,
       const double stepSize = 0.01,
       const size_t maxIterations = 100000,
       const double tolerance = 1e-5,
-      const bool shuffle = true);
+      const bool shuffle = true,
+      const size_t batchSize = 1);
 
   /**
    * Optimize the given function using stochastic gradient descent.  The given
@@ -109,7 +152,7 @@ class SGD
    * algorithm, and the final objective value is returned.
    *
    * @param iterate Starting point (will be modified).
-   * @return Objective value of the final point.
+   * @return Objective value of the final pass over the functions.
    */
   double Optimize(arma::mat& iterate);
 
@@ -138,6 +181,11 @@ class SGD
   //! Modify whether or not the individual functions are shuffled.
   bool& Shuffle() { return shuffle; }
 
+  //! Get the mini-batch size.
+  size_t BatchSize() const { return batchSize; }
+  //! Modify the mini-batch size.
+  size_t& BatchSize() { return batchSize; }
+
   // convert the obkect into a string
   std::string ToString() const;
 
@@ -157,6 +205,45 @@ class SGD
   //! Controls whether or not the individual functions are shuffled when
   //! iterating.
   bool shuffle;
+
+  //! The number of functions in each mini-batch.
+  size_t batchSize;
+
+  /**
+   * Compute the sum of the objective and the sum of the gradient of the
+   * functions begin, ..., begin + count - 1 at the given iterate.  The range is
+   * split into shards, which are evaluated in parallel and then reduced,
+   * unless the function's ShardBatches() returns false.
+   *
+   * @param iterate Point at which to evaluate.
+   * @param begin First function in the range.
+   * @param count Number of functions in the range.
+   * @param gradient Matrix to store the summed gradient in.
+   * @param shardGradients Work space for the gradient of each shard.
+   * @return Sum of the objective of the functions in the range.
+   */
+  double BatchEvaluateGradient(const arma::mat& iterate,
+                               const size_t begin,
+                               const size_t count,
+                               arma::mat& gradient,
+                               std::vector<arma::mat>& shardGradients);
+
+  //! Check for ShardBatches().
+  HAS_MEM_FUNC(ShardBatches, HasShardBatches)
+
+  //! Ask the function whether its mini-batches may be split into shards.
+  template<typename FunctionType>
+  bool ShardBatches(const FunctionType& f,
+                    typename boost::enable_if<HasShardBatches<
+                        FunctionType, bool(FunctionType::*)() const>
+                        >::type* = 0);
+
+  //! Mini-batches of functions without ShardBatches() are always sharded.
+  template<typename FunctionType>
+  bool ShardBatches(const FunctionType& f,
+                    typename boost::disable_if<HasShardBatches<
+                        FunctionType, bool(FunctionType::*)() const>
+                        >::type* = 0);
 };
 
 }; // namespace optimization
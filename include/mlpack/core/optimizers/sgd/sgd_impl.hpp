@@ -34,12 +34,14 @@ SGD<DecomposableFunctionType>::SGD(DecomposableFunctionType& function,
                                    const double stepSize,
                                    const size_t maxIterations,
                                    const double tolerance,
-                                   const bool shuffle) :
+                                   const bool shuffle,
+                                   const size_t batchSize) :
     function(function),
     stepSize(stepSize),
     maxIterations(maxIterations),
     tolerance(tolerance),
-    shuffle(shuffle)
+    shuffle(shuffle),
+    batchSize(batchSize)
 { /* Nothing to do. */ }
 
 //! Optimize the function (minimize).
@@ -49,27 +51,33 @@ double SGD<DecomposableFunctionType>::Optimize(arma::mat& iterate)
   // Find the number of functions to use.
   const size_t numFunctions = function.NumFunctions();
 
-  // This is used only if shuffle is true.
-  arma::vec visitationOrder;
+  // Each iteration takes one step with a mini-batch of functions.  The
+  // mini-batches are contiguous ranges of functions; when shuffle is true, the
+  // order in which they are visited is shuffled on every pass over the data.
+  if (batchSize == 0)
+    Log::Fatal << "SGD: batch size must be greater than 0." << std::endl;
+
+  const size_t numBatches = (numFunctions + batchSize - 1) / batchSize;
+  arma::Col<size_t> visitationOrder(numBatches);
+  for (size_t i = 0; i < numBatches; ++i)
+    visitationOrder[i] = i;
   if (shuffle)
-    visitationOrder = arma::shuffle(arma::linspace(0, (numFunctions - 1),
-        numFunctions));
+    visitationOrder = arma::shuffle(visitationOrder);
 
-  // To keep track of where we are and how things are going.
-  size_t currentFunction = 0;
+  // To keep track of where we are and how things are going.  The objective of
+  // a pass is the sum of the objectives of each mini-batch, as evaluated just
+  // before the step taken with it; this needs no extra evaluations.
+  size_t currentBatch = 0;
   double overallObjective = 0;
   double lastObjective = DBL_MAX;
 
-  // Calculate the first objective function.
-  for (size_t i = 0; i < numFunctions; ++i)
-    overallObjective += function.Evaluate(iterate, i);
-
   // Now iterate!
   arma::mat gradient(iterate.n_rows, iterate.n_cols);
-  for (size_t i = 1; i != maxIterations; ++i, ++currentFunction)
+  std::vector<arma::mat> shardGradients;
+  for (size_t i = 1; i != maxIterations; ++i, ++currentBatch)
   {
-    // Is this iteration the start of a sequence?
-    if ((currentFunction % numFunctions) == 0)
+    // Is this iteration the end of a pass over the data?
+    if (currentBatch == numBatches)
     {
       // Output current objective function.
       Log::Info << "SGD: iteration " << i << ", objective " << overallObjective
@@ -92,20 +100,20 @@ double SGD<DecomposableFunctionType>::Optimize(arma::mat& iterate)
       // Reset the counter variables.
       lastObjective = overallObjective;
       overallObjective = 0;
-      currentFunction = 0;
+      currentBatch = 0;
 
       if (shuffle) // Determine order of visitation.
         visitationOrder = arma::shuffle(visitationOrder);
     }
 
-    // Evaluate the gradient for this iteration.
-    function.Gradient(iterate, currentFunction, gradient);
-
-    // And update the iterate.
-    iterate -= stepSize * gradient;
+    // Evaluate the objective and the gradient of this mini-batch.
+    const size_t begin = visitationOrder[currentBatch] * batchSize;
+    const size_t count = std::min(batchSize, numFunctions - begin);
+    overallObjective += BatchEvaluateGradient(iterate, begin, count, gradient,
+        shardGradients);
 
-    // Now add that to the overall objective function.
-    overallObjective += function.Evaluate(iterate, currentFunction);
+    // And update the iterate with the average gradient of the mini-batch.
+    iterate -= (stepSize / count) * gradient;
   }
 
   Log::Info << "SGD: maximum iterations (" << maxIterations << ") reached; "
@@ -113,6 +121,65 @@ double SGD<DecomposableFunctionType>::Optimize(arma::mat& iterate)
   return overallObjective;
 }
 
+template<typename DecomposableFunctionType>
+double SGD<DecomposableFunctionType>::BatchEvaluateGradient(
+    const arma::mat& iterate,
+    const size_t begin,
+    const size_t count,
+    arma::mat& gradient,
+    std::vector<arma::mat>& shardGradients)
+{
+  // If the function's mini-batches can't be split, it parallelizes them itself.
+  if (!ShardBatches(function))
+    return BatchEvaluateWithGradient(function, iterate, begin, count,
+        gradient);
+
+  // Split the range into one shard per thread, but never into more shards than
+  // there are functions.
+  const size_t shards = std::min((size_t) omp_get_max_threads(), count);
+  shardGradients.resize(shards);
+
+  double objective = 0;
+  #pragma omp parallel for reduction(+:objective) schedule(static) \
+      if (shards > 1)
+  for (size_t shard = 0; shard < shards; ++shard)
+  {
+    const size_t shardBegin = begin + (shard * count) / shards;
+    const size_t shardCount = begin + ((shard + 1) * count) / shards -
+        shardBegin;
+
+    objective += BatchEvaluateWithGradient(function, iterate, shardBegin,
+        shardCount, shardGradients[shard]);
+  }
+
+  // Reduce the gradients of the shards.
+  gradient = shardGradients[0];
+  for (size_t shard = 1; shard < shards; ++shard)
+    gradient += shardGradients[shard];
+
+  return objective;
+}
+
+template<typename DecomposableFunctionType>
+template<typename FunctionType>
+bool SGD<DecomposableFunctionType>::ShardBatches(
+    const FunctionType& f,
+    typename boost::enable_if<HasShardBatches<FunctionType,
+        bool(FunctionType::*)() const> >::type*)
+{
+  return f.ShardBatches();
+}
+
+template<typename DecomposableFunctionType>
+template<typename FunctionType>
+bool SGD<DecomposableFunctionType>::ShardBatches(
+    const FunctionType& /* f */,
+    typename boost::disable_if<HasShardBatches<FunctionType,
+        bool(FunctionType::*)() const> >::type*)
+{
+  return true;
+}
+
 // Convert the object to a string.
 template<typename DecomposableFunctionType>
 std::string SGD<DecomposableFunctionType>::ToString() const
@@ -125,6 +192,7 @@ std::string SGD<DecomposableFunctionType>::ToString() const
   convert << "  Maximum iterations: " << maxIterations << std::endl;
   convert << "  Tolerance: " << tolerance << std::endl;
   convert << "  Shuffle points: " << (shuffle ? "true" : "false") << std::endl;
+  convert << "  Batch size: " << batchSize << std::endl;
   return convert.str();
 }
 
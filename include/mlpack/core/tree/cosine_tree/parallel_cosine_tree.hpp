@@ -0,0 +1,500 @@
+/**
+ * @file parallel_cosine_tree.hpp
+ *
+ * A cosine tree which is built a round at a time: in each round several nodes
+ * are split at once, the new basis vectors are orthonormalized together with
+ * block Gram-Schmidt, and the Monte Carlo error estimates of the new nodes are
+ * computed in parallel.
+ *
+ * This file is part of MLPACK 1.0.10.
+ *
+ * MLPACK is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * MLPACK is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details (LICENSE.txt).
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * MLPACK.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __MLPACK_CORE_TREE_COSINE_TREE_PARALLEL_COSINE_TREE_HPP
+#define __MLPACK_CORE_TREE_COSINE_TREE_PARALLEL_COSINE_TREE_HPP
+
+#include <mlpack/core.hpp>
+#include <boost/math/distributions/normal.hpp>
+
+namespace mlpack {
+namespace tree {
+
+/**
+ * This class builds the subspace basis of a matrix with a cosine tree, like
+ * CosineTree does, but uses several cores.  The tree is grown in rounds; in
+ * each round:
+ *
+ *  - the (up to) splitsPerRound leaves with the largest estimated error are
+ *    split at once, with the cosines and centroids of all of their columns
+ *    computed in one parallel pass;
+ *  - the centroids of the new children are orthonormalized against the basis
+ *    vectors of the other leaves as one block (two passes of classical block
+ *    Gram-Schmidt, followed by a QR decomposition of the block), so the work is
+ *    done with matrix-matrix products instead of one vector at a time;
+ *  - the Monte Carlo error estimates of the new children are computed in
+ *    parallel.  Each estimate uses its own random number generator, seeded from
+ *    math::RandInt() before the parallel region, so the results do not depend
+ *    on how the work is scheduled.
+ *
+ * The tree is grown until the Monte Carlo estimate of the error of the
+ * projection of the whole matrix onto the basis is at most epsilon times its
+ * squared Frobenius norm.  With splitsPerRound = 1 this is the same algorithm
+ * as CosineTree; with more splits per round the basis may be slightly larger
+ * than necessary, since the error is only checked between rounds.
+ *
+ * Nodes with at most numSamples columns have their error computed exactly
+ * instead of estimated.
+ */
+class ParallelCosineTree
+{
+ public:
+  /**
+   * Construct the cosine tree and the basis of the given matrix.
+   *
+   * @param dataset Matrix for which the cosine tree is constructed.
+   * @param epsilon Error tolerance fraction for calculated subspace.
+   * @param delta Cumulative probability for Monte Carlo error lower bound.
+   * @param splitsPerRound Number of nodes split in each round; if 0, the number
+   *     of threads is used.
+   * @param numSamples Number of columns sampled for each Monte Carlo error
+   *     estimate.
+   */
+  ParallelCosineTree(const arma::mat& dataset,
+                     const double epsilon,
+                     const double delta,
+                     const size_t splitsPerRound = 0,
+                     const size_t numSamples = 100) :
+      dataset(dataset),
+      epsilon(epsilon),
+      delta(delta),
+      splitsPerRound((splitsPerRound == 0) ? (size_t) omp_get_max_threads() :
+          splitsPerRound),
+      numSamples(std::max(numSamples, (size_t) 2))
+  {
+    // The squared norms of all the columns.
+    l2NormsSquared.set_size(dataset.n_cols);
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < dataset.n_cols; ++i)
+      l2NormsSquared[i] = arma::dot(dataset.unsafe_col(i),
+          dataset.unsafe_col(i));
+
+    // The root contains all of the columns.
+    Node root;
+    root.indices.resize(dataset.n_cols);
+    for (size_t i = 0; i < dataset.n_cols; ++i)
+      root.indices[i] = i;
+    root.centroid = arma::mean(dataset, 1);
+    FinishNode(root);
+
+    const double rootNorm = arma::norm(root.centroid, 2);
+    root.nonzero = (rootNorm > 0);
+    root.basisVector = (rootNorm > 0) ? arma::vec(root.centroid / rootNorm) :
+        arma::vec(arma::zeros<arma::vec>(dataset.n_rows));
+
+    arma::mat q = root.basisVector;
+    root.error = MonteCarloError(root, q, math::RandInt(INT_MAX));
+    leaves.push_back(root);
+    double error = root.error;
+
+    while (error > epsilon * root.frobNormSquared)
+    {
+      if (!SplitRound(q))
+        break;
+
+      error = MonteCarloError(root, q, math::RandInt(INT_MAX));
+      Log::Debug << "ParallelCosineTree: " << leaves.size() << " leaves, "
+          << "estimated error " << error << "." << std::endl;
+    }
+
+    // The basis is made of the basis vectors of the leaves; degenerate ones are
+    // left out.
+    size_t count = 0;
+    for (size_t i = 0; i < leaves.size(); ++i)
+      if (leaves[i].nonzero)
+        ++count;
+
+    basis.set_size(dataset.n_rows, count);
+    count = 0;
+    for (size_t i = 0; i < leaves.size(); ++i)
+      if (leaves[i].nonzero)
+        basis.col(count++) = leaves[i].basisVector;
+  }
+
+  //! Returns the basis of the constructed subspace.
+  void GetFinalBasis(arma::mat& finalBasis) const { finalBasis = basis; }
+
+  //! Get the number of leaves of the tree.
+  size_t NumLeaves() const { return leaves.size(); }
+
+  //! Get the number of nodes split in each round.
+  size_t SplitsPerRound() const { return splitsPerRound; }
+
+ private:
+  //! A node of the tree; only the leaves are kept.
+  struct Node
+  {
+    //! Indices of columns of input matrix in the node.
+    std::vector<size_t> indices;
+    //! Cumulative sums of the squared norms of the columns in the node.
+    arma::vec cumulativeNorms;
+    //! Centroid of the columns of the node.
+    arma::vec centroid;
+    //! Orthonormalized basis vector of the node.
+    arma::vec basisVector;
+    //! Whether the basis vector is nonzero.
+    bool nonzero;
+    //! Whether the node can still be split.
+    bool splittable;
+    //! Frobenius norm squared of columns in the node.
+    double frobNormSquared;
+    //! Monte Carlo error for this node.
+    double error;
+
+    Node() : nonzero(true), splittable(true), frobNormSquared(0), error(0) { }
+  };
+
+  //! A contiguous range of the columns of one node, processed by one thread.
+  struct Chunk
+  {
+    size_t node;
+    size_t begin;
+    size_t end;
+  };
+
+  //! Matrix for which cosine tree is constructed.
+  const arma::mat& dataset;
+  //! Error tolerance fraction for calculated subspace.
+  double epsilon;
+  //! Cumulative probability for Monte Carlo error lower bound.
+  double delta;
+  //! Number of nodes split in each round.
+  size_t splitsPerRound;
+  //! Number of columns sampled for each Monte Carlo error estimate.
+  size_t numSamples;
+  //! Squared norms of the columns of the dataset.
+  arma::vec l2NormsSquared;
+  //! The leaves of the tree.
+  std::vector<Node> leaves;
+  //! Subspace basis of the input dataset.
+  arma::mat basis;
+
+  //! Split the columns of the given nodes into chunks of at most 1024 columns.
+  static std::vector<Chunk> MakeChunks(const std::vector<size_t>& sizes)
+  {
+    const size_t chunkSize = 1024;
+    std::vector<Chunk> chunks;
+    for (size_t n = 0; n < sizes.size(); ++n)
+    {
+      for (size_t begin = 0; begin < sizes[n]; begin += chunkSize)
+      {
+        Chunk chunk;
+        chunk.node = n;
+        chunk.begin = begin;
+        chunk.end = std::min(begin + chunkSize, sizes[n]);
+        chunks.push_back(chunk);
+      }
+    }
+
+    return chunks;
+  }
+
+  //! Compute the Frobenius norm and the cumulative norms of a node.
+  void FinishNode(Node& node) const
+  {
+    node.cumulativeNorms.set_size(node.indices.size());
+    double sum = 0;
+    for (size_t i = 0; i < node.indices.size(); ++i)
+    {
+      sum += l2NormsSquared[node.indices[i]];
+      node.cumulativeNorms[i] = sum;
+    }
+    node.frobNormSquared = sum;
+    node.splittable = (node.indices.size() > 1) && (sum > 0);
+  }
+
+  /**
+   * Split the leaves with the largest errors, and update the basis q of the
+   * leaves.  Returns false if no leaf could be split.
+   */
+  bool SplitRound(arma::mat& q)
+  {
+    // Choose the leaves to split.
+    std::vector<std::pair<double, size_t> > candidates;
+    for (size_t i = 0; i < leaves.size(); ++i)
+      if (leaves[i].splittable)
+        candidates.push_back(std::make_pair(leaves[i].error, i));
+    if (candidates.empty())
+      return false;
+
+    const size_t splits = std::min(splitsPerRound, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + splits,
+        candidates.end(), std::greater<std::pair<double, size_t> >());
+
+    std::vector<size_t> chosen(splits), sizes(splits);
+    for (size_t s = 0; s < splits; ++s)
+    {
+      chosen[s] = candidates[s].second;
+      sizes[s] = leaves[chosen[s]].indices.size();
+    }
+
+    // Sample the split point of each node from its length-squared distribution.
+    std::vector<size_t> splitPoints(splits);
+    for (size_t s = 0; s < splits; ++s)
+    {
+      const Node& node = leaves[chosen[s]];
+      const double value = math::Random() * node.frobNormSquared;
+      const size_t i = std::min((size_t) (std::upper_bound(
+          node.cumulativeNorms.begin(), node.cumulativeNorms.end(), value) -
+          node.cumulativeNorms.begin()), node.indices.size() - 1);
+      splitPoints[s] = node.indices[i];
+    }
+
+    // Compute the cosines of all the columns with their split points.
+    std::vector<arma::vec> cosines(splits);
+    for (size_t s = 0; s < splits; ++s)
+      cosines[s].set_size(sizes[s]);
+
+    std::vector<Chunk> chunks = MakeChunks(sizes);
+
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t c = 0; c < chunks.size(); ++c)
+    {
+      const Node& node = leaves[chosen[chunks[c].node]];
+      const size_t splitPoint = splitPoints[chunks[c].node];
+      const double splitNorm = l2NormsSquared[splitPoint];
+      for (size_t i = chunks[c].begin; i < chunks[c].end; ++i)
+      {
+        const size_t index = node.indices[i];
+        const double norms = splitNorm * l2NormsSquared[index];
+        cosines[chunks[c].node][i] = (norms > 0) ? std::fabs(arma::dot(
+            dataset.unsafe_col(splitPoint), dataset.unsafe_col(index))) /
+            sqrt(norms) : 0;
+      }
+    }
+
+    // Partition the columns of each node: columns closer to the largest cosine
+    // go left, and columns closer to the smallest go right.
+    std::vector<Node> children(2 * splits);
+    std::vector<size_t> split;
+    for (size_t s = 0; s < splits; ++s)
+    {
+      const Node& node = leaves[chosen[s]];
+      const double cosineMax = arma::max(cosines[s]);
+      const double cosineMin = arma::min(cosines[s]);
+      for (size_t i = 0; i < node.indices.size(); ++i)
+      {
+        if ((cosineMax - cosines[s][i]) <= (cosines[s][i] - cosineMin))
+          children[2 * s].indices.push_back(node.indices[i]);
+        else
+          children[2 * s + 1].indices.push_back(node.indices[i]);
+      }
+
+      // If all of the columns are equally similar, the node can't be split.
+      if (children[2 * s].indices.empty() ||
+          children[2 * s + 1].indices.empty())
+        leaves[chosen[s]].splittable = false;
+      else
+        split.push_back(s);
+    }
+
+    if (split.empty())
+      return true;
+
+    // Compute the centroids of the children, with one partial sum per chunk,
+    // added up in order.
+    std::vector<Node> newNodes;
+    std::vector<size_t> childSizes;
+    for (size_t s = 0; s < split.size(); ++s)
+    {
+      for (size_t side = 0; side < 2; ++side)
+      {
+        newNodes.push_back(Node());
+        newNodes.back().indices.swap(children[2 * split[s] + side].indices);
+        childSizes.push_back(newNodes.back().indices.size());
+      }
+    }
+
+    chunks = MakeChunks(childSizes);
+    arma::mat partialSums(dataset.n_rows, chunks.size());
+
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t c = 0; c < chunks.size(); ++c)
+    {
+      const std::vector<size_t>& indices = newNodes[chunks[c].node].indices;
+      arma::vec sum = arma::zeros<arma::vec>(dataset.n_rows);
+      for (size_t i = chunks[c].begin; i < chunks[c].end; ++i)
+        sum += dataset.unsafe_col(indices[i]);
+      partialSums.col(c) = sum;
+    }
+
+    arma::mat centroids = arma::zeros<arma::mat>(dataset.n_rows,
+        newNodes.size());
+    for (size_t c = 0; c < chunks.size(); ++c)
+      centroids.col(chunks[c].node) += partialSums.col(c);
+    for (size_t n = 0; n < newNodes.size(); ++n)
+    {
+      centroids.col(n) /= (double) newNodes[n].indices.size();
+      newNodes[n].centroid = centroids.col(n);
+      FinishNode(newNodes[n]);
+    }
+
+    // Replace the split nodes by their children; the basis vectors of the
+    // remaining leaves are kept.
+    std::vector<bool> isSplit(leaves.size(), false);
+    for (size_t s = 0; s < split.size(); ++s)
+      isSplit[chosen[split[s]]] = true;
+
+    std::vector<Node> remaining;
+    for (size_t i = 0; i < leaves.size(); ++i)
+    {
+      if (!isSplit[i])
+      {
+        remaining.push_back(Node());
+        std::swap(remaining.back(), leaves[i]);
+      }
+    }
+    leaves.swap(remaining);
+
+    arma::mat rest(dataset.n_rows, leaves.size());
+    for (size_t i = 0; i < leaves.size(); ++i)
+      rest.col(i) = leaves[i].basisVector;
+
+    // Orthonormalize the centroids of the children against the rest of the
+    // basis, and against each other.
+    arma::mat block;
+    std::vector<bool> nonzero;
+    BlockGramSchmidt(rest, centroids, block, nonzero);
+
+    const size_t first = leaves.size();
+    for (size_t n = 0; n < newNodes.size(); ++n)
+    {
+      newNodes[n].basisVector = block.col(n);
+      newNodes[n].nonzero = nonzero[n];
+      leaves.push_back(Node());
+      std::swap(leaves.back(), newNodes[n]);
+    }
+
+    q = arma::join_rows(rest, block);
+
+    // Estimate the errors of the children in parallel, each with its own
+    // random number generator.
+    std::vector<int> seeds(leaves.size() - first);
+    for (size_t n = 0; n < seeds.size(); ++n)
+      seeds[n] = math::RandInt(INT_MAX);
+
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t n = first; n < leaves.size(); ++n)
+      leaves[n].error = MonteCarloError(leaves[n], q, seeds[n - first]);
+
+    return true;
+  }
+
+  /**
+   * Orthonormalize the columns of c against the orthonormal columns of q (with
+   * two passes of block Gram-Schmidt) and against each other (with a QR
+   * decomposition).  Columns that are numerically in the span of q and of the
+   * previous columns of c are set to zero; this includes every column past the
+   * dimension of the space, when c has more columns than rows.
+   */
+  static void BlockGramSchmidt(const arma::mat& q,
+                               const arma::mat& c,
+                               arma::mat& output,
+                               std::vector<bool>& nonzero)
+  {
+    arma::mat projected = c;
+    if (q.n_cols > 0)
+    {
+      for (size_t pass = 0; pass < 2; ++pass)
+        projected -= q * (trans(q) * projected);
+    }
+
+    arma::mat r;
+    arma::qr_econ(output, r, projected);
+
+    // If c has more columns than rows, the economical QR decomposition only
+    // gives as many columns as rows; the rest are zero.
+    output.resize(c.n_rows, c.n_cols);
+
+    nonzero.resize(c.n_cols);
+    for (size_t i = 0; i < c.n_cols; ++i)
+    {
+      nonzero[i] = (i < r.n_rows) &&
+          (std::fabs(r(i, i)) > 1e-10 * arma::norm(c.col(i), 2));
+      if (!nonzero[i])
+        output.col(i).zeros();
+    }
+  }
+
+  /**
+   * Estimate the squared error of the projection of the columns of the given
+   * node onto the orthonormal basis q.  The squared norms of the projections of
+   * columns sampled from the length-squared distribution of the node, divided
+   * by their probabilities, are unbiased estimates of the squared norm of the
+   * projection of the node; the error is the Frobenius norm squared of the node
+   * minus a lower bound of their mean (with confidence 1 - delta).  If the node
+   * has few columns, the error is computed exactly.
+   */
+  double MonteCarloError(const Node& node,
+                         const arma::mat& q,
+                         const int seed) const
+  {
+    if (node.frobNormSquared == 0)
+      return 0;
+
+    const size_t count = node.indices.size();
+    if (count <= numSamples)
+    {
+      arma::uvec columns(count);
+      for (size_t i = 0; i < count; ++i)
+        columns[i] = node.indices[i];
+
+      const arma::mat projections = trans(q) * dataset.cols(columns);
+      return std::max(node.frobNormSquared -
+          arma::accu(arma::square(projections)), 0.0);
+    }
+
+    boost::random::mt19937 generator(seed);
+    boost::random::uniform_01<> uniform;
+
+    arma::uvec columns(numSamples);
+    arma::vec probabilities(numSamples);
+    for (size_t i = 0; i < numSamples; ++i)
+    {
+      const double value = uniform(generator) * node.frobNormSquared;
+      const size_t index = std::min((size_t) (std::upper_bound(
+          node.cumulativeNorms.begin(), node.cumulativeNorms.end(), value) -
+          node.cumulativeNorms.begin()), count - 1);
+      columns[i] = node.indices[index];
+      probabilities[i] = l2NormsSquared[columns[i]] / node.frobNormSquared;
+    }
+
+    const arma::mat projections = trans(q) * dataset.cols(columns);
+    const arma::vec weightedMagnitudes =
+        trans(arma::sum(arma::square(projections), 0)) / probabilities;
+
+    const double mu = arma::mean(weightedMagnitudes);
+    const double sigma = arma::stddev(weightedMagnitudes);
+
+    boost::math::normal dist(0, 1);
+    const double lowerBound = mu - boost::math::quantile(dist, 1 - delta) *
+        sigma / sqrt((double) numSamples);
+
+    return std::max(node.frobNormSquared - std::max(lowerBound, 0.0), 0.0);
+  }
+};
+
+}; // namespace tree
+}; // namespace mlpack
+
+#endif
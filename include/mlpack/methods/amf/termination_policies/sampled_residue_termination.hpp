@@ -0,0 +1,200 @@
+/**
+ * @file sampled_residue_termination.hpp
+ *
+ * Termination policy for AMF which estimates the RMSE of the factorization on
+ * a fixed random sample of the nonzero entries of the matrix.
+ *
+ * This file is part of MLPACK 1.0.10.
+ *
+ * MLPACK is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * MLPACK is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details (LICENSE.txt).
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * MLPACK.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __MLPACK_METHODS_AMF_TERMINATION_POLICIES_SAMPLED_RESIDUE_TERMINATION_HPP
+#define __MLPACK_METHODS_AMF_TERMINATION_POLICIES_SAMPLED_RESIDUE_TERMINATION_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace amf {
+
+/**
+ * This termination policy estimates the RMSE of the factorization on a random
+ * sample of the nonzero entries of V, which is chosen once, when the policy is
+ * initialized.  Each check costs O(samples r) time (computed in parallel), no
+ * matter how large V is.  The factorization is considered converged when the
+ * estimated RMSE improves by less than the given relative tolerance, or when
+ * the maximum number of iterations is reached.
+ *
+ * This is meant for update rules where one iteration is a pass over all of the
+ * data, such as SVDParallelIncrementalLearning.
+ */
+class SampledResidueTermination
+{
+ public:
+  /**
+   * Initialize the termination policy.
+   *
+   * @param tolerance Minimum relative improvement of the RMSE.
+   * @param maxIterations Maximum number of iterations (0 for no limit).
+   * @param samples Number of nonzero entries to estimate the RMSE with.
+   */
+  SampledResidueTermination(const double tolerance = 1e-5,
+                            const size_t maxIterations = 10000,
+                            const size_t samples = 100000) :
+      tolerance(tolerance),
+      maxIterations(maxIterations),
+      samples(samples)
+  { }
+
+  /**
+   * Choose the sample of nonzero entries of V.
+   *
+   * @param V Matrix to be factorized.
+   */
+  template<typename MatType>
+  void Initialize(const MatType& V)
+  {
+    residue = DBL_MAX;
+    iteration = 1;
+
+    // Gather the nonzero entries column by column.
+    std::vector<size_t> rows, cols;
+    std::vector<double> values;
+    GetNonzeros(V, rows, cols, values);
+
+    // Take a random sample of them (or all of them, if there are few).
+    const size_t count = std::min(samples, values.size());
+    sampleRows.set_size(count);
+    sampleCols.set_size(count);
+    sampleValues.set_size(count);
+    if (count == 0)
+      return;
+
+    const arma::uvec order = arma::shuffle(arma::linspace<arma::uvec>(0,
+        values.size() - 1, values.size()));
+    for (size_t s = 0; s < count; ++s)
+    {
+      sampleRows[s] = rows[order[s]];
+      sampleCols[s] = cols[order[s]];
+      sampleValues[s] = values[order[s]];
+    }
+  }
+
+  /**
+   * Estimate the RMSE of the current factorization, and check for
+   * convergence.
+   *
+   * @param W Basis matrix.
+   * @param H Encoding matrix.
+   */
+  bool IsConverged(arma::mat& W, arma::mat& H)
+  {
+    const double residueOld = residue;
+
+    // The rows of W are accessed many times, so make them contiguous.
+    const arma::mat wt = trans(W);
+    double sum = 0;
+
+    #pragma omp parallel for reduction(+:sum) schedule(static)
+    for (size_t s = 0; s < sampleValues.n_elem; ++s)
+    {
+      const double error = sampleValues[s] - dot(wt.unsafe_col(sampleRows[s]),
+          H.unsafe_col(sampleCols[s]));
+      sum += error * error;
+    }
+
+    residue = (sampleValues.n_elem == 0) ? 0 :
+        sqrt(sum / sampleValues.n_elem);
+
+    Log::Debug << "SampledResidueTermination: iteration " << iteration
+        << ", estimated RMSE " << residue << "." << std::endl;
+
+    iteration++;
+
+    if (maxIterations != 0 && iteration > maxIterations)
+      return true;
+
+    return (residueOld != DBL_MAX) &&
+        ((residueOld - residue) / residueOld < tolerance);
+  }
+
+  //! Get the estimated RMSE of the last iteration.
+  const double& Index() { return residue; }
+  //! Get the current iteration.
+  const size_t& Iteration() { return iteration; }
+  //! Get the maximum number of iterations.
+  const size_t& MaxIterations() { return maxIterations; }
+
+ private:
+  //! Minimum relative improvement of the RMSE.
+  double tolerance;
+  //! Maximum number of iterations.
+  size_t maxIterations;
+  //! Number of nonzero entries to sample.
+  size_t samples;
+
+  //! The estimated RMSE of the last iteration.
+  double residue;
+  //! The current iteration.
+  size_t iteration;
+
+  //! Rows of the sampled entries.
+  arma::Col<size_t> sampleRows;
+  //! Columns of the sampled entries.
+  arma::Col<size_t> sampleCols;
+  //! Values of the sampled entries.
+  arma::vec sampleValues;
+
+  //! Get the nonzero entries of a dense matrix.
+  template<typename MatType>
+  static void GetNonzeros(const MatType& V,
+                          std::vector<size_t>& rows,
+                          std::vector<size_t>& cols,
+                          std::vector<double>& values)
+  {
+    for (size_t j = 0; j < V.n_cols; ++j)
+    {
+      for (size_t i = 0; i < V.n_rows; ++i)
+      {
+        if (V(i, j) != 0)
+        {
+          rows.push_back(i);
+          cols.push_back(j);
+          values.push_back(V(i, j));
+        }
+      }
+    }
+  }
+
+  //! Get the nonzero entries of a sparse matrix.
+  static void GetNonzeros(const arma::sp_mat& V,
+                          std::vector<size_t>& rows,
+                          std::vector<size_t>& cols,
+                          std::vector<double>& values)
+  {
+    for (size_t j = 0; j < V.n_cols; ++j)
+    {
+      for (size_t l = V.col_ptrs[j]; l < V.col_ptrs[j + 1]; ++l)
+      {
+        rows.push_back(V.row_indices[l]);
+        cols.push_back(j);
+        values.push_back(V.values[l]);
+      }
+    }
+  }
+};
+
+}; // namespace amf
+}; // namespace mlpack
+
+#endif
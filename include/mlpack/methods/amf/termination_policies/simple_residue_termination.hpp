@@ -47,11 +47,10 @@ class SimpleResidueTermination
 
   bool IsConverged(arma::mat& W, arma::mat& H)
   {
-    // Calculate norm of WH after each iteration.
-    arma::mat WH;
-
-    WH = W * H;
-    double norm = sqrt(accu(WH % WH) / nm);
+    // Calculate norm of WH after each iteration.  ||WH||_F^2 is the sum of
+    // the entries of (W^T W) % (H H^T), so WH itself is never formed.
+    const double normSquared = accu((W.t() * W) % (H * H.t()));
+    double norm = sqrt(std::max(normSquared, 0.0) / nm);
 
     if (iteration != 0)
     {
@@ -21,6 +21,7 @@
 #define _MLPACK_METHODS_AMF_SIMPLE_TOLERANCE_TERMINATION_HPP_INCLUDED
 
 #include <mlpack/core.hpp>
+#include <mlpack/methods/amf/update_rules/sparse_products.hpp>
 
 namespace mlpack {
 namespace amf {
@@ -53,30 +54,11 @@ class SimpleToleranceTermination
 
   bool IsConverged(arma::mat& W, arma::mat& H)
   {
-    // Calculate norm of WH after each iteration.
-    arma::mat WH;
-
-    WH = W * H;
-
+    // Calculate the RMSE over the nonzero entries of V after each iteration.
     residueOld = residue;
-    size_t n = V->n_rows;
-    size_t m = V->n_cols;
     double sum = 0;
     size_t count = 0;
-    for(size_t i = 0;i < n;i++)
-    {
-        for(size_t j = 0;j < m;j++)
-        {
-            double temp = 0;
-            if((temp = (*V)(i,j)) != 0)
-            {
-                temp = (temp - WH(i, j));
-                temp = temp * temp;
-                sum += temp;
-                count++;
-            }
-        }
-    }
+    SquaredError(*V, W, H, sum, count);
     residue = sum / count;
     residue = sqrt(residue);
 
@@ -121,6 +103,53 @@ class SimpleToleranceTermination
   const size_t& MaxIterations() { return maxIterations; }
 
  private:
+  //! Compute the squared error over the nonzero entries of a dense V.
+  template<typename DenseMatType>
+  static void SquaredError(const DenseMatType& V,
+                           const arma::mat& W,
+                           const arma::mat& H,
+                           double& sum,
+                           size_t& count)
+  {
+    const arma::mat WH = W * H;
+    for(size_t i = 0;i < V.n_rows;i++)
+    {
+        for(size_t j = 0;j < V.n_cols;j++)
+        {
+            double temp = 0;
+            if((temp = V(i,j)) != 0)
+            {
+                temp = (temp - WH(i, j));
+                temp = temp * temp;
+                sum += temp;
+                count++;
+            }
+        }
+    }
+  }
+
+  //! Compute the squared error over the nonzero entries of a sparse V, without
+  //! forming WH; this takes O(nnz(V) r) time.
+  static void SquaredError(const arma::sp_mat& V,
+                           const arma::mat& W,
+                           const arma::mat& H,
+                           double& sum,
+                           size_t& count)
+  {
+    arma::vec estimates;
+    SparseEstimates(W, H, V, estimates);
+    for (size_t l = 0; l < V.n_nonzero; ++l)
+    {
+      // Explicitly stored zeros are skipped, as in the dense case.
+      if (V.values[l] != 0)
+      {
+        const double error = V.values[l] - estimates[l];
+        sum += error * error;
+        count++;
+      }
+    }
+  }
+
   double tolerance;
   size_t maxIterations;
 
@@ -28,24 +28,56 @@ namespace mlpack
 {
 namespace amf
 {
+/**
+ * This termination policy holds out some of the nonzero entries of V as a
+ * validation set, and stops the factorization when the RMSE on them stops
+ * improving by more than the given relative tolerance for reverseStepTolerance
+ * consecutive evaluations (or when the maximum number of iterations is
+ * reached).
+ *
+ * The validation RMSE is computed in parallel, directly from the rows of W and
+ * the columns of H, so WH is never formed; it can also be evaluated only every
+ * evaluationInterval iterations.  When the RMSE first stops improving, W and H
+ * are saved, and they are restored when the factorization terminates unless
+ * the RMSE has since improved on the RMSE before the save.  The saved copy is
+ * kept in buffers which are allocated only once, and it is swapped (not
+ * copied) back into W and H.
+ */
 template <class MatType>
 class ValidationRMSETermination
 {
  public:
+  /**
+   * Create the termination policy, moving num_test_points random nonzero
+   * entries of V into the validation set (they are set to zero in V).
+   *
+   * @param V Matrix to be factorized.
+   * @param num_test_points Number of entries to use for validation.
+   * @param tolerance Minimum relative improvement of the validation RMSE.
+   * @param maxIterations Maximum number of iterations.
+   * @param reverseStepTolerance Number of consecutive evaluations without
+   *     enough improvement before terminating.
+   * @param evaluationInterval Evaluate the validation RMSE every this many
+   *     iterations.
+   */
   ValidationRMSETermination(MatType& V,
                             size_t num_test_points,
                             double tolerance = 1e-5,
                             size_t maxIterations = 10000,
-                            size_t reverseStepTolerance = 3)
+                            size_t reverseStepTolerance = 3,
+                            size_t evaluationInterval = 1)
         : tolerance(tolerance),
           maxIterations(maxIterations),
           num_test_points(num_test_points),
-          reverseStepTolerance(reverseStepTolerance)
+          reverseStepTolerance(reverseStepTolerance),
+          evaluationInterval(std::max(evaluationInterval, (size_t) 1))
   {
     size_t n = V.n_rows;
     size_t m = V.n_cols;
 
-    test_points.zeros(num_test_points, 3);
+    testRows.set_size(num_test_points);
+    testCols.set_size(num_test_points);
+    testValues.set_size(num_test_points);
 
     for(size_t i = 0; i < num_test_points; i++)
     {
@@ -58,9 +90,9 @@ class ValidationRMSETermination
         t_col = rand() % m;
       } while((t_val = V(t_row, t_col)) == 0);
 
-      test_points(i, 0) = t_row;
-      test_points(i, 1) = t_col;
-      test_points(i, 2) = t_val;
+      testRows(i) = t_row;
+      testCols(i) = t_col;
+      testValues(i) = t_val;
       V(t_row, t_col) = 0;
     }
   }
@@ -68,6 +100,7 @@ class ValidationRMSETermination
   void Initialize(const MatType& /* V */)
   {
     iteration = 1;
+    evaluations = 0;
 
     rmse = DBL_MAX;
     rmseOld = DBL_MAX;
@@ -81,48 +114,36 @@ class ValidationRMSETermination
 
   bool IsConverged(arma::mat& W, arma::mat& H)
   {
-    // Calculate norm of WH after each iteration.
-    arma::mat WH;
-
-    WH = W * H;
+    const bool evaluate = ((iteration - 1) % evaluationInterval == 0);
+    iteration++;
 
-    if (iteration != 0)
+    if (evaluate)
     {
       rmseOld = rmse;
-      rmse = 0;
-      for(size_t i = 0; i < num_test_points; i++)
-      {
-        size_t t_row = test_points(i, 0);
-        size_t t_col = test_points(i, 1);
-        double t_val = test_points(i, 2);
-        double temp = (t_val - WH(t_row, t_col));
-        temp *= temp;
-        rmse += temp;
-      }
-      rmse /= num_test_points;
-      rmse = sqrt(rmse);
-    }
+      rmse = ValidationRMSE(W, H);
+      evaluations++;
 
-    iteration++;
-  
-    if((rmseOld - rmse) / rmseOld < tolerance && iteration > 4)
-    {
-      if(reverseStepCount == 0 && isCopy == false)
+      if((rmseOld - rmse) / rmseOld < tolerance && evaluations > 3)
       {
-        isCopy = true;
-        this->W = W;
-        this->H = H;
-        c_indexOld = rmseOld;
-        c_index = rmse;
+        // The RMSE has stopped improving, so save the factorization (only the
+        // first time).
+        if(reverseStepCount == 0 && isCopy == false)
+        {
+          isCopy = true;
+          this->W = W;
+          this->H = H;
+          c_indexOld = rmseOld;
+          c_index = rmse;
+        }
+        reverseStepCount++;
       }
-      reverseStepCount++;
-    }
-    else
-    {
-      reverseStepCount = 0;
-      if(rmse <= c_indexOld && isCopy == true)
+      else
       {
-        isCopy = false;
+        reverseStepCount = 0;
+        if(rmse <= c_indexOld && isCopy == true)
+        {
+          isCopy = false;
+        }
       }
     }
 
@@ -130,39 +151,71 @@ class ValidationRMSETermination
     {
       if(isCopy)
       {
-        W = this->W;
-        H = this->H;
+        W.swap(this->W);
+        H.swap(this->H);
         rmse = c_index;
       }
       return true;
     }
     else return false;
   }
-  
+
   const double& Index() { return rmse; }
 
   const size_t& Iteration() { return iteration; }
-  
+
   const size_t& MaxIterations() { return maxIterations; }
 
  private:
+  //! Compute the RMSE on the validation set, in parallel.
+  double ValidationRMSE(const arma::mat& W, const arma::mat& H) const
+  {
+    // The rows of W are accessed many times, so make them contiguous.
+    const arma::mat wt = trans(W);
+
+    double sum = 0;
+    #pragma omp parallel for reduction(+:sum) schedule(static)
+    for(size_t i = 0; i < num_test_points; i++)
+    {
+      const double error = testValues(i) - dot(wt.unsafe_col(testRows(i)),
+          H.unsafe_col(testCols(i)));
+      sum += error * error;
+    }
+
+    return sqrt(sum / num_test_points);
+  }
+
   double tolerance;
   size_t maxIterations;
   size_t num_test_points;
   size_t iteration;
+  //! Number of times the validation RMSE has been evaluated.
+  size_t evaluations;
 
-  arma::Mat<double> test_points;
+  //! Rows of the validation entries.
+  arma::Col<size_t> testRows;
+  //! Columns of the validation entries.
+  arma::Col<size_t> testCols;
+  //! Values of the validation entries.
+  arma::vec testValues;
 
   double rmseOld;
   double rmse;
 
   size_t reverseStepTolerance;
   size_t reverseStepCount;
-  
+  //! Evaluate the validation RMSE every this many iterations.
+  size_t evaluationInterval;
+
+  //! Whether W and H hold a saved factorization to restore.
   bool isCopy;
+  //! The saved W.
   arma::mat W;
+  //! The saved H.
   arma::mat H;
+  //! The validation RMSE before the one of the saved factorization.
   double c_indexOld;
+  //! The validation RMSE of the saved factorization.
   double c_index;
 };
 
@@ -10,6 +10,9 @@
  * \f$ \sqrt{\sum_i \sum_j(V-WH)^2} \f$ by alternately calculating W and H
  * respectively while holding the other matrix constant.
  *
+ * For sparse matrices, the products with V only touch its nonzero entries, so
+ * each update takes O(nnz(V) r + (n + m) r^2) time.
+ *
  * This file is part of MLPACK 1.0.10.
  *
  * MLPACK is free software: you can redistribute it and/or modify it under the
@@ -29,6 +32,7 @@
 #define __MLPACK_METHODS_LMF_UPDATE_RULES_NMF_ALS_HPP
 
 #include <mlpack/core.hpp>
+#include "sparse_products.hpp"
 
 namespace mlpack {
 namespace amf {
@@ -110,6 +114,49 @@ class NMFALSUpdate
   }
 };
 
+/**
+ * The update rule for the basis matrix W, for sparse V.  V H^T is computed from
+ * the nonzero entries of V only (in parallel), and the normal equations are the
+ * same for every row of W, so the r x r pseudoinverse is only computed once.
+ */
+template<>
+inline void NMFALSUpdate::WUpdate<arma::sp_mat>(const arma::sp_mat& V,
+                                                arma::mat& W,
+                                                const arma::mat& H)
+{
+  arma::mat hvt;
+  SparseTransProduct(H, V, hvt);
+  W = trans(hvt) * pinv(H * H.t());
+
+  // Set all negative numbers to 0.
+  for (size_t i = 0; i < W.n_elem; i++)
+  {
+    if (W(i) < 0.0)
+      W(i) = 0.0;
+  }
+}
+
+/**
+ * The update rule for the encoding matrix H, for sparse V.  W^T V is computed
+ * from the nonzero entries of V only (in parallel).
+ */
+template<>
+inline void NMFALSUpdate::HUpdate<arma::sp_mat>(const arma::sp_mat& V,
+                                                const arma::mat& W,
+                                                arma::mat& H)
+{
+  arma::mat wtv;
+  SparseProduct(trans(W), V, wtv);
+  H = pinv(W.t() * W) * wtv;
+
+  // Set all negative numbers to 0.
+  for (size_t i = 0; i < H.n_elem; i++)
+  {
+    if (H(i) < 0.0)
+      H(i) = 0.0;
+  }
+}
+
 }; // namespace amf
 }; // namespace mlpack
 
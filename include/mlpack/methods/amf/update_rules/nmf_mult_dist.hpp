@@ -28,6 +28,7 @@
 #define __MLPACK_METHODS_LMF_UPDATE_RULES_NMF_MULT_DIST_UPDATE_RULES_HPP
 
 #include <mlpack/core.hpp>
+#include "sparse_products.hpp"
 
 namespace mlpack {
 namespace amf {
@@ -65,7 +66,8 @@ class NMFMultiplicativeDistanceUpdate
                              arma::mat& W,
                              const arma::mat& H)
   {
-    W = (W % (V * H.t())) / (W * H * H.t());
+    // W H H^T is computed as W (H H^T), so that W H is never formed.
+    W = (W % (V * H.t())) / (W * (H * H.t()));
   }
 
   /**
@@ -85,10 +87,36 @@ class NMFMultiplicativeDistanceUpdate
                              const arma::mat& W,
                              arma::mat& H)
   {
-    H = (H % (W.t() * V)) / (W.t() * W * H);
+    H = (H % (W.t() * V)) / ((W.t() * W) * H);
   }
 };
 
+//! The update rule for the basis matrix W, for sparse V.  V H^T is computed
+//! from the nonzero entries of V only, so this takes O(nnz(V) r + n r^2) time.
+template<>
+inline void NMFMultiplicativeDistanceUpdate::WUpdate<arma::sp_mat>(
+    const arma::sp_mat& V,
+    arma::mat& W,
+    const arma::mat& H)
+{
+  arma::mat hvt;
+  SparseTransProduct(H, V, hvt);
+  W = (W % trans(hvt)) / (W * (H * H.t()));
+}
+
+//! The update rule for the encoding matrix H, for sparse V.  W^T V is computed
+//! from the nonzero entries of V only, so this takes O(nnz(V) r + m r^2) time.
+template<>
+inline void NMFMultiplicativeDistanceUpdate::HUpdate<arma::sp_mat>(
+    const arma::sp_mat& V,
+    const arma::mat& W,
+    arma::mat& H)
+{
+  arma::mat wtv;
+  SparseProduct(trans(W), V, wtv);
+  H = (H % wtv) / ((W.t() * W) * H);
+}
+
 }; // namespace amf
 }; // namespace mlpack
 
@@ -33,6 +33,7 @@
 #define __MLPACK_METHODS_LMF_UPDATE_RULES_NMF_MULT_DIV_HPP
 
 #include <mlpack/core.hpp>
+#include "sparse_products.hpp"
 
 namespace mlpack {
 namespace amf {
@@ -68,28 +69,10 @@ class NMFMultiplicativeDivergenceUpdate
                             arma::mat& W,
                             const arma::mat& H)
   {
-    // Simple implementation left in the header file.
-    arma::mat t1;
-    arma::rowvec t2;
-
-    t1 = W * H;
-    for (size_t i = 0; i < W.n_rows; ++i)
-    {
-      for (size_t j = 0; j < W.n_cols; ++j)
-      {
-        // Writing this as a single expression does not work as of Armadillo
-        // 3.920.  This should be fixed in a future release, and then the code
-        // below can be fixed.
-        //t2 = H.row(j) % V.row(i) / t1.row(i);
-        t2.set_size(H.n_cols);
-        for (size_t k = 0; k < t2.n_elem; ++k)
-        {
-          t2(k) = H(j, k) * V(i, k) / t1(i, k);
-        }
-
-        W(i, j) = W(i, j) * sum(t2) / sum(H.row(j));
-      }
-    }
+    // The numerator is (V / (WH)) H^T, and the denominator is the sum of each
+    // row of H.
+    W %= (V / (W * H)) * H.t();
+    W.each_row() /= trans(sum(H, 1));
   }
 
   /**
@@ -110,31 +93,56 @@ class NMFMultiplicativeDivergenceUpdate
                             const arma::mat& W,
                             arma::mat& H)
   {
-    // Simple implementation left in the header file.
-    arma::mat t1;
-    arma::colvec t2;
-
-    t1 = W * H;
-    for (size_t i = 0; i < H.n_rows; i++)
-    {
-      for (size_t j = 0; j < H.n_cols; j++)
-      {
-        // Writing this as a single expression does not work as of Armadillo
-        // 3.920.  This should be fixed in a future release, and then the code
-        // below can be fixed.
-        //t2 = W.col(i) % V.col(j) / t1.col(j);
-        t2.set_size(W.n_rows);
-        for (size_t k = 0; k < t2.n_elem; ++k)
-        {
-          t2(k) = W(k, i) * V(k, j) / t1(k, j);
-        }
-
-        H(i,j) = H(i,j) * sum(t2) / sum(W.col(i));
-      }
-    }
+    // The numerator is W^T (V / (WH)), and the denominator is the sum of each
+    // column of W.
+    H %= W.t() * (V / (W * H));
+    H.each_col() /= trans(sum(W, 0));
   }
 };
 
+/**
+ * The update rule for the basis matrix W, for sparse V.  The terms of the
+ * numerator with V_{i\mu} = 0 vanish, so V / (WH) is only computed at the
+ * nonzero entries of V, and the update takes O(nnz(V) r) time.
+ */
+template<>
+inline void NMFMultiplicativeDivergenceUpdate::WUpdate<arma::sp_mat>(
+    const arma::sp_mat& V,
+    arma::mat& W,
+    const arma::mat& H)
+{
+  arma::vec ratios;
+  SparseEstimates(W, H, V, ratios);
+  for (size_t l = 0; l < V.n_nonzero; ++l)
+    ratios[l] = V.values[l] / ratios[l];
+
+  arma::mat numerator;
+  SparseTransProduct(H, SparsePattern(V, ratios), numerator);
+  W %= trans(numerator);
+  W.each_row() /= trans(sum(H, 1));
+}
+
+/**
+ * The update rule for the encoding matrix H, for sparse V.  As for W, V / (WH)
+ * is only computed at the nonzero entries of V.
+ */
+template<>
+inline void NMFMultiplicativeDivergenceUpdate::HUpdate<arma::sp_mat>(
+    const arma::sp_mat& V,
+    const arma::mat& W,
+    arma::mat& H)
+{
+  arma::vec ratios;
+  SparseEstimates(W, H, V, ratios);
+  for (size_t l = 0; l < V.n_nonzero; ++l)
+    ratios[l] = V.values[l] / ratios[l];
+
+  arma::mat numerator;
+  SparseProduct(trans(W), SparsePattern(V, ratios), numerator);
+  H %= numerator;
+  H.each_col() /= trans(sum(W, 0));
+}
+
 }; // namespace amf
 }; // namespace mlpack
 
@@ -0,0 +1,132 @@
+/**
+ * @file sparse_products.hpp
+ *
+ * Products of dense factor matrices with sparse data matrices, which only
+ * touch the nonzero entries of the data, for the sparse versions of the AMF
+ * update rules and termination policies.
+ *
+ * This file is part of MLPACK 1.0.10.
+ *
+ * MLPACK is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * MLPACK is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details (LICENSE.txt).
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * MLPACK.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __MLPACK_METHODS_AMF_UPDATE_RULES_SPARSE_PRODUCTS_HPP
+#define __MLPACK_METHODS_AMF_UPDATE_RULES_SPARSE_PRODUCTS_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace amf {
+
+/**
+ * Compute output = a * v, for a dense matrix a and a sparse matrix v, in
+ * O(nnz(v) a.n_rows) time.  Each column of the output only depends on one
+ * column of v, so the columns are computed in parallel.
+ *
+ * @param a Dense matrix (for instance, W^T or H).
+ * @param v Sparse matrix.
+ * @param output Matrix to store a * v in.
+ */
+inline void SparseProduct(const arma::mat& a,
+                          const arma::sp_mat& v,
+                          arma::mat& output)
+{
+  output.zeros(a.n_rows, v.n_cols);
+
+  #pragma omp parallel for schedule(dynamic, 64)
+  for (size_t j = 0; j < v.n_cols; ++j)
+  {
+    double* outputCol = output.colptr(j);
+    for (size_t l = v.col_ptrs[j]; l < v.col_ptrs[j + 1]; ++l)
+    {
+      const double value = v.values[l];
+      const double* aCol = a.colptr(v.row_indices[l]);
+      for (size_t k = 0; k < a.n_rows; ++k)
+        outputCol[k] += value * aCol[k];
+    }
+  }
+}
+
+/**
+ * Compute output = a * trans(v), for a dense matrix a and a sparse matrix v.
+ * The transpose of v is formed (in O(nnz(v)) time), so that the columns of the
+ * output can be computed in parallel without conflicts.
+ *
+ * @param a Dense matrix (for instance, H).
+ * @param v Sparse matrix.
+ * @param output Matrix to store a * trans(v) in.
+ */
+inline void SparseTransProduct(const arma::mat& a,
+                               const arma::sp_mat& v,
+                               arma::mat& output)
+{
+  const arma::sp_mat vt = trans(v);
+  SparseProduct(a, vt, output);
+}
+
+/**
+ * Compute the entries of W * H at the nonzero entries of v, in the order in
+ * which the nonzero values of v are stored, in O(nnz(v) r) time.
+ *
+ * @param w Basis matrix (n x r).
+ * @param h Encoding matrix (r x m).
+ * @param v Sparse matrix (n x m).
+ * @param estimates Vector to store the estimates in (one per nonzero of v).
+ */
+inline void SparseEstimates(const arma::mat& w,
+                            const arma::mat& h,
+                            const arma::sp_mat& v,
+                            arma::vec& estimates)
+{
+  // The rows of W are accessed many times, so make them contiguous.
+  const arma::mat wt = trans(w);
+
+  estimates.set_size(v.n_nonzero);
+
+  #pragma omp parallel for schedule(dynamic, 64)
+  for (size_t j = 0; j < v.n_cols; ++j)
+  {
+    const double* hCol = h.colptr(j);
+    for (size_t l = v.col_ptrs[j]; l < v.col_ptrs[j + 1]; ++l)
+    {
+      const double* wRow = wt.colptr(v.row_indices[l]);
+      double estimate = 0;
+      for (size_t k = 0; k < h.n_rows; ++k)
+        estimate += wRow[k] * hCol[k];
+      estimates[l] = estimate;
+    }
+  }
+}
+
+/**
+ * Create a sparse matrix with the same nonzero pattern as v, but with the given
+ * values (in the order in which the nonzero values of v are stored).
+ *
+ * @param v Sparse matrix whose pattern is used.
+ * @param values Values of the new matrix.
+ */
+inline arma::sp_mat SparsePattern(const arma::sp_mat& v,
+                                  const arma::vec& values)
+{
+  const arma::uvec rowIndices(const_cast<arma::uword*>(v.row_indices),
+      v.n_nonzero);
+  const arma::uvec colPtrs(const_cast<arma::uword*>(v.col_ptrs),
+      v.n_cols + 1);
+
+  return arma::sp_mat(rowIndices, colPtrs, values, v.n_rows, v.n_cols);
+}
+
+}; // namespace amf
+}; // namespace mlpack
+
+#endif
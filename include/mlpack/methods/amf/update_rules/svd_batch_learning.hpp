@@ -21,6 +21,7 @@
 #define __MLPACK_METHODS_AMF_UPDATE_RULES_SVD_BATCHLEARNING_HPP
 
 #include <mlpack/core.hpp>
+#include "sparse_products.hpp"
 
 namespace mlpack
 {
@@ -72,6 +73,8 @@ class SVDBatchLearning
     arma::mat deltaW(n, r);
     deltaW.zeros();
 
+    // Each row of deltaW only depends on its own row of W.
+    #pragma omp parallel for schedule(static)
     for(size_t i = 0;i < n;i++)
     {
       for(size_t j = 0;j < m;j++)
@@ -112,6 +115,8 @@ class SVDBatchLearning
     arma::mat deltaH(r, m);
     deltaH.zeros();
 
+    // Each column of deltaH only depends on its own column of H.
+    #pragma omp parallel for schedule(static)
     for(size_t j = 0;j < m;j++)
     {
       for(size_t i = 0;i < n;i++)
@@ -140,63 +145,54 @@ class SVDBatchLearning
   arma::mat mH;
 };
 
-template<> 
+//! The update rule for the basis matrix W, for sparse V.  The residues are
+//! only computed at the nonzero entries of V, and both they and the gradient
+//! are computed in parallel, in O(nnz(V) r) time.
+template<>
 inline void SVDBatchLearning::WUpdate<arma::sp_mat>(const arma::sp_mat& V,
                                                     arma::mat& W,
                                                     const arma::mat& H)
 {
-  size_t n = V.n_rows;
-
-  size_t r = W.n_cols;
-
   mW = momentum * mW;
 
-  arma::mat deltaW(n, r);
-  deltaW.zeros();
+  // The residues V - WH at the nonzero entries of V.
+  arma::vec residues;
+  SparseEstimates(W, H, V, residues);
+  for (size_t l = 0; l < V.n_nonzero; ++l)
+    residues[l] = V.values[l] - residues[l];
 
-  for(arma::sp_mat::const_iterator it = V.begin();it != V.end();it++)
-  {
-    size_t row = it.row();
-    size_t col = it.col();
-    deltaW.row(it.row()) += (*it - arma::dot(W.row(row), H.col(col))) * 
-                                                  arma::trans(H.col(col));
-  }
+  // deltaW = (V - WH) H^T, over the nonzero entries of V.
+  arma::mat deltaWt;
+  SparseTransProduct(H, SparsePattern(V, residues), deltaWt);
+  arma::mat deltaW = trans(deltaWt);
 
-  if(kw != 0) for(size_t i = 0; i < n; i++)
-  {
-    deltaW.row(i) -= kw * W.row(i);
-  }
+  if(kw != 0) deltaW -= kw * W;
 
   mW += u * deltaW;
   W += mW;
 }
 
+//! The update rule for the encoding matrix H, for sparse V.  The residues are
+//! only computed at the nonzero entries of V, and both they and the gradient
+//! are computed in parallel, in O(nnz(V) r) time.
 template<>
 inline void SVDBatchLearning::HUpdate<arma::sp_mat>(const arma::sp_mat& V,
                                                     const arma::mat& W,
                                                     arma::mat& H)
 {
-  size_t m = V.n_cols;
-
-  size_t r = W.n_cols;
-
   mH = momentum * mH;
 
-  arma::mat deltaH(r, m);
-  deltaH.zeros();
+  // The residues V - WH at the nonzero entries of V.
+  arma::vec residues;
+  SparseEstimates(W, H, V, residues);
+  for (size_t l = 0; l < V.n_nonzero; ++l)
+    residues[l] = V.values[l] - residues[l];
 
-  for(arma::sp_mat::const_iterator it = V.begin();it != V.end();it++)
-  {
-    size_t row = it.row();
-    size_t col = it.col();
-    deltaH.col(col) += (*it - arma::dot(W.row(row), H.col(col))) * 
-                                                arma::trans(W.row(row));
-  }
+  // deltaH = W^T (V - WH), over the nonzero entries of V.
+  arma::mat deltaH;
+  SparseProduct(trans(W), SparsePattern(V, residues), deltaH);
 
-  if(kh != 0) for(size_t j = 0; j < m; j++)
-  {
-    deltaH.col(j) -= kh * H.col(j);
-  }
+  if(kh != 0) deltaH -= kh * H;
 
   mH += u*deltaH;
   H += mH;
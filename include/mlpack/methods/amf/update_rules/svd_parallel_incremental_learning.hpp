@@ -0,0 +1,256 @@
+/**
+ * @file svd_parallel_incremental_learning.hpp
+ *
+ * Parallel incremental SVD update rule for AMF, which updates W and H with
+ * stochastic gradient steps on the nonzero entries of V, using the stratified
+ * block schedule of distributed SGD (DSGD) so that threads never touch the same
+ * rows of W or columns of H at the same time.
+ *
+ * This file is part of MLPACK 1.0.10.
+ *
+ * MLPACK is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * MLPACK is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details (LICENSE.txt).
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * MLPACK.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __MLPACK_METHODS_AMF_UPDATE_RULES_SVD_PARALLEL_INCREMENTAL_LEARNING_HPP
+#define __MLPACK_METHODS_AMF_UPDATE_RULES_SVD_PARALLEL_INCREMENTAL_LEARNING_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace amf {
+
+/**
+ * This class implements a parallel version of the incremental SVD learning
+ * rules (SVDCompleteIncrementalLearning), in the style of DSGD (Gemulla et al.,
+ * "Large-scale matrix factorization with distributed stochastic gradient
+ * descent", KDD 2011).  The rows (items) and columns (users) of V are
+ * randomly partitioned into B blocks each, which splits V into B x B blocks.
+ * For each nonzero entry V_ij, the step
+ *
+ * \f[
+ * e = V_{ij} - W_i H_j, \quad
+ * W_i \leftarrow W_i + u (e H_j^T - k_w W_i), \quad
+ * H_j \leftarrow H_j + u (e W_i^T - k_h H_j)
+ * \f]
+ *
+ * is taken.  An epoch is split into B strata; in stratum s, block (b, b + s mod
+ * B) is processed for every b.  The blocks of a stratum share no rows and no
+ * columns, so they are processed by different threads at once, without locks.
+ *
+ * Each call to WUpdate() performs one full epoch over the nonzero entries of V
+ * (updating both W and H), and HUpdate() does nothing, so each iteration of
+ * AMF is one epoch.  This means the usual termination policies (such as
+ * SimpleResidueTermination or SampledResidueTermination) can be used
+ * directly, instead of the incremental termination wrappers.
+ *
+ * @code
+ * extern arma::sp_mat V;
+ * arma::mat W, H;
+ *
+ * AMF<SampledResidueTermination, RandomInitialization,
+ *     SVDParallelIncrementalLearning> amf;
+ * amf.Apply(V, 10, W, H);
+ * @endcode
+ */
+class SVDParallelIncrementalLearning
+{
+ public:
+  /**
+   * Initialize the parallel incremental SVD learning rule.
+   *
+   * @param u Step size.
+   * @param kw Regularization parameter for W.
+   * @param kh Regularization parameter for H.
+   * @param blocks Number of blocks the rows and columns are each split into;
+   *     if 0, the number of threads is used.
+   */
+  SVDParallelIncrementalLearning(const double u = 0.001,
+                                 const double kw = 0,
+                                 const double kh = 0,
+                                 const size_t blocks = 0) :
+      u(u), kw(kw), kh(kh), blocks(blocks)
+  { }
+
+  /**
+   * Partition the nonzero entries of the dataset into blocks.  The entries of
+   * each block are stored together (in a random order), so an epoch does not
+   * need to search the dataset.
+   *
+   * @param dataset Matrix to be factorized.
+   * @param rank Rank of the factorization.
+   */
+  template<typename MatType>
+  void Initialize(const MatType& dataset, const size_t rank)
+  {
+    (void) rank;
+
+    numBlocks = (blocks == 0) ? (size_t) omp_get_max_threads() : blocks;
+    numBlocks = std::max(std::min(numBlocks,
+        std::min((size_t) dataset.n_rows, (size_t) dataset.n_cols)),
+        (size_t) 1);
+
+    // Assign the rows and columns to blocks at random, so that the blocks are
+    // balanced even if the data is sorted.
+    const arma::uvec rowOrder = arma::shuffle(arma::linspace<arma::uvec>(0,
+        dataset.n_rows - 1, dataset.n_rows));
+    const arma::uvec colOrder = arma::shuffle(arma::linspace<arma::uvec>(0,
+        dataset.n_cols - 1, dataset.n_cols));
+    rowBlock.set_size(dataset.n_rows);
+    for (size_t i = 0; i < dataset.n_rows; ++i)
+      rowBlock[rowOrder[i]] = (i * numBlocks) / dataset.n_rows;
+    colBlock.set_size(dataset.n_cols);
+    for (size_t j = 0; j < dataset.n_cols; ++j)
+      colBlock[colOrder[j]] = (j * numBlocks) / dataset.n_cols;
+
+    entries.clear();
+    entries.resize(numBlocks * numBlocks);
+    AddEntries(dataset);
+
+    // Visit the entries of each block in a random order.
+    for (size_t b = 0; b < entries.size(); ++b)
+    {
+      if (entries[b].empty())
+        continue;
+
+      const arma::uvec order = arma::shuffle(arma::linspace<arma::uvec>(0,
+          entries[b].size() - 1, entries[b].size()));
+      std::vector<Entry> shuffled(entries[b].size());
+      for (size_t l = 0; l < order.n_elem; ++l)
+        shuffled[l] = entries[b][order[l]];
+      entries[b].swap(shuffled);
+    }
+  }
+
+  /**
+   * Perform one epoch of stochastic gradient steps over the nonzero entries of
+   * V, updating both W and H.
+   *
+   * @param V Input matrix to be factorized (unused; the entries were stored by
+   *     Initialize()).
+   * @param W Basis matrix to be updated.
+   * @param H Encoding matrix to be updated.
+   */
+  template<typename MatType>
+  inline void WUpdate(const MatType& /* V */,
+                      arma::mat& W,
+                      arma::mat& H)
+  {
+    // Work on the transpose of W, so that each row of W is contiguous.
+    arma::mat wt = trans(W);
+    const size_t r = wt.n_rows;
+
+    for (size_t stratum = 0; stratum < numBlocks; ++stratum)
+    {
+      #pragma omp parallel for schedule(dynamic)
+      for (size_t b = 0; b < numBlocks; ++b)
+      {
+        const std::vector<Entry>& block =
+            entries[b * numBlocks + (b + stratum) % numBlocks];
+        for (size_t l = 0; l < block.size(); ++l)
+        {
+          double* w = wt.colptr(block[l].item);
+          double* h = H.colptr(block[l].user);
+
+          double error = block[l].value;
+          for (size_t k = 0; k < r; ++k)
+            error -= w[k] * h[k];
+
+          for (size_t k = 0; k < r; ++k)
+          {
+            const double wk = w[k];
+            w[k] += u * (error * h[k] - kw * wk);
+            h[k] += u * (error * wk - kh * h[k]);
+          }
+        }
+      }
+    }
+
+    W = trans(wt);
+  }
+
+  /**
+   * H is updated together with W by WUpdate(), so this does nothing.
+   *
+   * @param V Input matrix to be factorized.
+   * @param W Basis matrix.
+   * @param H Encoding matrix.
+   */
+  template<typename MatType>
+  inline void HUpdate(const MatType& /* V */,
+                      const arma::mat& /* W */,
+                      arma::mat& /* H */)
+  { }
+
+  //! Get the number of blocks the rows and columns are split into.
+  size_t NumBlocks() const { return numBlocks; }
+
+ private:
+  //! A nonzero entry of the matrix to be factorized.
+  struct Entry
+  {
+    size_t item;
+    size_t user;
+    double value;
+  };
+
+  //! Step size.
+  double u;
+  //! Regularization parameter for W.
+  double kw;
+  //! Regularization parameter for H.
+  double kh;
+  //! Requested number of blocks (0 for the number of threads).
+  size_t blocks;
+
+  //! The number of blocks the rows and columns are split into.
+  size_t numBlocks;
+  //! The block of each row.
+  arma::Col<size_t> rowBlock;
+  //! The block of each column.
+  arma::Col<size_t> colBlock;
+  //! The nonzero entries of each block (row block major).
+  std::vector<std::vector<Entry> > entries;
+
+  //! Add an entry to its block.
+  void AddEntry(const size_t item, const size_t user, const double value)
+  {
+    Entry entry;
+    entry.item = item;
+    entry.user = user;
+    entry.value = value;
+    entries[rowBlock[item] * numBlocks + colBlock[user]].push_back(entry);
+  }
+
+  //! Add the nonzero entries of a dense matrix to their blocks.
+  template<typename MatType>
+  void AddEntries(const MatType& dataset)
+  {
+    for (size_t j = 0; j < dataset.n_cols; ++j)
+      for (size_t i = 0; i < dataset.n_rows; ++i)
+        if (dataset(i, j) != 0)
+          AddEntry(i, j, dataset(i, j));
+  }
+
+  //! Add the nonzero entries of a sparse matrix to their blocks.
+  void AddEntries(const arma::sp_mat& dataset)
+  {
+    for (size_t j = 0; j < dataset.n_cols; ++j)
+      for (size_t l = dataset.col_ptrs[j]; l < dataset.col_ptrs[j + 1]; ++l)
+        AddEntry(dataset.row_indices[l], j, dataset.values[l]);
+  }
+};
+
+}; // namespace amf
+}; // namespace mlpack
+
+#endif
@@ -32,6 +32,7 @@
 #include <mlpack/methods/amf/termination_policies/simple_residue_termination.hpp>
 #include <set>
 #include <map>
+#include <queue>
 #include <iostream>
 
 namespace mlpack {
@@ -51,14 +52,31 @@ namespace cf /** Collaborative filtering. */{
  *
  * CF<> cf(data); // Default options.
  *
+ * // Factorize the data.  If this is not done, the first call to
+ * // GetRecommendations() will do it.
+ * cf.Train();
+ *
  * // Generate 10 recommendations for all users.
  * cf.GetRecommendations(10, recommendations);
  *
  * // Generate 10 recommendations for specified users.
  * cf.GetRecommendations(10, recommendations, users);
  *
+ * // Save the trained model, and load it into another object.
+ * cf.Save("cf.xml");
+ * CF<> cf2;
+ * cf2.Load("cf.xml");
  * @endcode
  *
+ * The factorization and the neighborhood of every user are only computed by
+ * Train(), so any number of calls to GetRecommendations() can be made for the
+ * cost of one factorization.
+ *
+ * The neighborhood of each user is found in the rank-r space of the
+ * factorization, and the estimated ratings are computed one user at a time
+ * (in parallel, if OpenMP is available), so the dense items x users rating
+ * matrix is never formed; only O((users + items) r) memory is used.
+ *
  * The data matrix is a (user, item, rating) table.  Each column in the matrix
  * should have three rows.  The first represents the user; the second represents
  * the item; and the third represents the rating.  The user and item, while they
@@ -90,6 +108,12 @@ class CF
      const size_t numUsersForSimilarity = 5,
      const size_t rank = 0);
 
+  /**
+   * Initialize an empty CF object.  A trained model must be loaded with Load()
+   * before recommendations can be generated.
+   */
+  CF();
+
   //! Sets number of users for calculating similarity.
   void NumUsersForSimilarity(const size_t num)
   {
@@ -100,6 +124,9 @@ class CF
       return;
     }
     this->numUsersForSimilarity = num;
+
+    // The neighborhoods will be recomputed when they are next needed.
+    neighborhood.reset();
   }
 
   //! Gets number of users for calculating similarity.
@@ -108,9 +135,15 @@ class CF
     return numUsersForSimilarity;
   }
 
-  //! Sets rank parameter for matrix factorization.
+  //! Sets rank parameter for matrix factorization.  If the rank changes, the
+  //! model will be retrained when recommendations are next generated.
   void Rank(const size_t rankValue)
   {
+    if (rankValue != rank)
+    {
+      w.reset();
+      h.reset();
+    }
     this->rank = rankValue;
   }
 
@@ -120,7 +153,7 @@ class CF
     return rank;
   }
 
-  //! Sets factorizer for NMF
+  //! Sets factorizer for NMF.  This only affects the next call to Train().
   void Factorizer(const FactorizerType& f)
   {
     this->factorizer = f;
@@ -130,12 +163,22 @@ class CF
   const arma::mat& W() const { return w; }
   //! Get the Item Matrix.
   const arma::mat& H() const { return h; }
-  //! Get the Rating Matrix.
-  const arma::mat& Rating() const { return rating; }
+  //! Get the Rating Matrix.  This is computed from the user and item matrices
+  //! every time, and it is dense (items x users), so it can be very large.
+  arma::mat Rating() const { return w * h; }
   //! Get the data matrix.
   const arma::mat& Data() const { return data; }
   //! Get the cleaned data matrix.
   const arma::sp_mat& CleanedData() const { return cleanedData; }
+  //! Get the neighborhood of each user (one column per user).
+  const arma::Mat<size_t>& Neighborhood() const { return neighborhood; }
+
+  /**
+   * Factorize the rating matrix and compute the neighborhood of every user.
+   * This is the expensive part of collaborative filtering; after it is done,
+   * recommendations can be generated cheaply for any set of users.
+   */
+  void Train();
 
   /**
    * Generates the given number of recommendations for all users.
@@ -157,6 +200,44 @@ class CF
                           arma::Mat<size_t>& recommendations,
                           arma::Col<size_t>& users);
 
+  /**
+   * Add new ratings to the model, which may be of new users and new items.
+   * Instead of retraining, the new ratings are folded into the existing
+   * factorization: a few alternating least squares passes solve for the
+   * factors of the users with new ratings and of the new items, with all other
+   * factors held fixed.  The neighborhoods of the affected users (the users
+   * with new ratings, and every new user, even one without ratings) are then
+   * recomputed by brute force, which costs O(n r) per affected user for n
+   * users; the neighborhoods of other users are not (call Train() to refresh
+   * the whole model).  New items change the distances between all users, so
+   * then the n users are also mapped to the new space, in O(n r^2) time.  If
+   * the model has not been trained yet, the ratings are only added to the data.
+   *
+   * A rating of an item that the user has already rated replaces the old
+   * rating.
+   *
+   * @param newData New (user, item, rating) table.
+   * @param iterations Number of alternating least squares passes.
+   * @param lambda Regularization parameter for the least squares problems.
+   */
+  void AddRatings(const arma::mat& newData,
+                  const size_t iterations = 5,
+                  const double lambda = 0.01);
+
+  /**
+   * Save the trained model (the data and its factorization) to a file.
+   *
+   * @param filename Name of file to save to.
+   */
+  void Save(const std::string& filename) const;
+
+  /**
+   * Load a trained model from a file, replacing the current model.
+   *
+   * @param filename Name of file to load from.
+   */
+  void Load(const std::string& filename);
+
   /**
    * Returns a string representation of this object.
    */
@@ -175,28 +256,44 @@ class CF
   arma::mat w;
   //! Item matrix.
   arma::mat h;
-  //! Rating matrix.
-  arma::mat rating;
   //! Cleaned data matrix.
   arma::sp_mat cleanedData;
+  //! The neighborhood of each user.
+  arma::Mat<size_t> neighborhood;
+  //! The R factor of the thin QR decomposition of w, so that the distance
+  //! between the ratings of two users is the distance between their columns of
+  //! R * h.
+  arma::mat wFactor;
+  //! The users in the space where the neighborhoods are found (R * h).
+  arma::mat userFactors;
   //! Converts the User, Item, Value Matrix to User-Item Table
   void CleanData();
 
+  //! Compute the neighborhood of every user from the factorization.
+  void ComputeNeighborhood();
+
   /**
-   * Helper function to insert a point into the recommendation matrices.
-   *
-   * @param queryIndex Index of point whose recommendations we are inserting
-   *     into.
-   * @param pos Position in list to insert into.
-   * @param neighbor Index of item being inserted as a recommendation.
-   * @param value Value of recommendation.
+   * Recompute the neighborhoods of the given users only, by brute force
+   * against all of the users in userFactors.  This takes O(users.n_elem * n *
+   * r) time for n users, with the users handled in parallel.
+   */
+  void UpdateNeighborhoods(const std::vector<size_t>& users);
+
+  //! A candidate recommendation: its estimated rating and its item.
+  typedef std::pair<double, size_t> Candidate;
+
+  /**
+   * Order candidate recommendations so that the top of a priority queue is the
+   * worst candidate: the one with the lowest rating, and of those, the one with
+   * the highest item index (so ties are broken in favor of earlier items).
    */
-  void InsertNeighbor(const size_t queryIndex,
-                      const size_t pos,
-                      const size_t neighbor,
-                      const double value,
-                      arma::Mat<size_t>& recommendations,
-                      arma::mat& values) const;
+  struct CandidateCompare
+  {
+    bool operator()(const Candidate& a, const Candidate& b) const
+    {
+      return (a.first > b.first) || (a.first == b.first && a.second < b.second);
+    }
+  };
 
 }; // class CF
 
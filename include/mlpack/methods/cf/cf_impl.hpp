@@ -51,27 +51,23 @@ CF<FactorizerType>::CF(arma::mat& data,
   CleanData();
 }
 
+/**
+ * Construct an empty CF object, to be filled with Load().
+ */
 template<typename FactorizerType>
-void CF<FactorizerType>::GetRecommendations(const size_t numRecs,
-                                            arma::Mat<size_t>& recommendations)
+CF<FactorizerType>::CF() :
+    numUsersForSimilarity(5),
+    rank(0),
+    factorizer()
 {
-  // Generate list of users.  Maybe it would be more efficient to pass an empty
-  // users list, and then have the other overload of GetRecommendations() assume
-  // that if users is empty, then recommendations should be generated for all
-  // users?
-  arma::Col<size_t> users = arma::linspace<arma::Col<size_t> >(0,
-      cleanedData.n_cols - 1, cleanedData.n_cols);
-
-  // Call the main overload for recommendations.
-  GetRecommendations(numRecs, recommendations, users);
+  // Nothing to do.
 }
 
 template<typename FactorizerType>
-void CF<FactorizerType>::GetRecommendations(const size_t numRecs,
-                                            arma::Mat<size_t>& recommendations,
-                                            arma::Col<size_t>& users)
+void CF<FactorizerType>::Train()
 {
-  // Base function for calculating recommendations.
+  if (cleanedData.n_elem == 0)
+    Log::Fatal << "CF::Train(): no data to train on!" << std::endl;
 
   // Check if the user wanted us to choose a rank for them.
   if (rank == 0)
@@ -88,85 +84,411 @@ void CF<FactorizerType>::GetRecommendations(const size_t numRecs,
     rank = rankEstimate;
   }
 
-  // Operations independent of the query:
   // Decompose the sparse data matrix to user and data matrices.
   factorizer.Apply(cleanedData, rank, w, h);
 
-  // Generate new table by multiplying approximate values.
-  rating = w * h;
-
-  // Now, we will use the decomposed w and h matrices to estimate what the user
-  // would have rated items as, and then pick the best items.
-
-  // Temporarily store feature vector of queried users.
-  arma::mat query(rating.n_rows, users.n_elem);
-
-  // Select feature vectors of queried users.
-  for (size_t i = 0; i < users.n_elem; i++)
-    query.col(i) = rating.col(users(i));
+  ComputeNeighborhood();
+}
 
-  // Temporary storage for neighborhood of the queried users.
-  arma::Mat<size_t> neighborhood;
+template<typename FactorizerType>
+void CF<FactorizerType>::ComputeNeighborhood()
+{
+  // The distance between the ratings of two users is ||w (h_u - h_v)||, and
+  // with the thin QR decomposition w = QR, this is ||R (h_u - h_v)||.  So the
+  // neighborhoods can be found in the rank-r space of the columns of R * h,
+  // without forming the rating matrix w * h (which has one entry for every
+  // (item, user) pair).
+  arma::mat q;
+  arma::qr_econ(q, wFactor, w);
+  userFactors = wFactor * h;
 
-  // Calculate the neighborhood of the queried users.
+  // Calculate the neighborhood of every user.  Each user is a query as well as
+  // a reference point, so each user is part of its own neighborhood.
   // This should be a templatized option.
-  neighbor::AllkNN a(rating, query);
+  neighbor::AllkNN a(userFactors, userFactors);
   arma::mat resultingDistances; // Temporary storage.
   a.Search(numUsersForSimilarity, neighborhood, resultingDistances);
+}
 
-  // Temporary storage for storing the average rating for each user in their
-  // neighborhood.
-  arma::mat averages = arma::zeros<arma::mat>(rating.n_rows, query.n_cols);
+template<typename FactorizerType>
+void CF<FactorizerType>::GetRecommendations(const size_t numRecs,
+                                            arma::Mat<size_t>& recommendations)
+{
+  // Generate list of users.  Maybe it would be more efficient to pass an empty
+  // users list, and then have the other overload of GetRecommendations() assume
+  // that if users is empty, then recommendations should be generated for all
+  // users?
+  arma::Col<size_t> users = arma::linspace<arma::Col<size_t> >(0,
+      cleanedData.n_cols - 1, cleanedData.n_cols);
 
-  // Iterate over each query user.
-  for (size_t i = 0; i < neighborhood.n_cols; ++i)
-  {
-    // Iterate over each neighbor of the query user.
-    for (size_t j = 0; j < neighborhood.n_rows; ++j)
-      averages.col(i) += rating.col(neighborhood(j, i));
-    // Normalize average.
-    averages.col(i) /= neighborhood.n_rows;
-  }
+  // Call the main overload for recommendations.
+  GetRecommendations(numRecs, recommendations, users);
+}
+
+template<typename FactorizerType>
+void CF<FactorizerType>::GetRecommendations(const size_t numRecs,
+                                            arma::Mat<size_t>& recommendations,
+                                            arma::Col<size_t>& users)
+{
+  // Base function for calculating recommendations.
+
+  // Factorize the data, unless that has already been done.
+  if (w.n_elem == 0 || h.n_elem == 0)
+    Train();
+  else if (neighborhood.n_elem == 0)
+    ComputeNeighborhood();
+
+  // Now, we will use the decomposed w and h matrices to estimate what the user
+  // would have rated items as, and then pick the best items.
 
   // Generate recommendations for each query user by finding the maximum numRecs
-  // elements in the averages matrix.
+  // elements of the average rating of their neighborhood.
   recommendations.set_size(numRecs, users.n_elem);
   recommendations.fill(cleanedData.n_rows); // Invalid item number.
-  arma::mat values(numRecs, users.n_elem);
-  values.fill(-DBL_MAX); // The smallest possible value.
-  for (size_t i = 0; i < users.n_elem; i++)
+
+  // The query users are independent, so they are handled in parallel.  Each
+  // thread only keeps the estimated ratings of the user it is working on.
+  #pragma omp parallel
   {
-    // Look through the averages column corresponding to the current user.
-    for (size_t j = 0; j < averages.n_rows; ++j)
+    arma::vec averageFactors(h.n_rows);
+    arma::vec averages(w.n_rows);
+    std::vector<bool> rated(w.n_rows, false);
+
+    #pragma omp for schedule(dynamic)
+    for (size_t i = 0; i < users.n_elem; i++)
     {
-      // Ensure that the user hasn't already rated the item.
-      if (cleanedData(j, users(i)) != 0.0)
-        continue; // The user already rated the item.
+      // The average rating of the neighborhood is w times the average of the
+      // neighbors' columns of h.
+      averageFactors.zeros();
+      const size_t user = users(i);
+      for (size_t j = 0; j < neighborhood.n_rows; ++j)
+        averageFactors += h.col(neighborhood(j, user));
+      averageFactors /= neighborhood.n_rows;
+      averages = w * averageFactors;
+
+      // Mark the items the user has already rated.
+      for (size_t l = cleanedData.col_ptrs[user];
+           l < cleanedData.col_ptrs[user + 1]; ++l)
+        rated[cleanedData.row_indices[l]] = true;
 
-      // Is the estimated value better than the worst candidate?
-      const double value = averages(j, i);
-      if (value > values(values.n_rows - 1, i))
+      // Keep the best numRecs items in a heap whose top is the worst of them.
+      std::priority_queue<Candidate, std::vector<Candidate>, CandidateCompare>
+          best;
+      for (size_t j = 0; j < averages.n_elem; ++j)
       {
-        // It should be inserted.  Which position?
-        size_t insertPosition = values.n_rows - 1;
-        while (insertPosition > 0)
+        if (rated[j])
+          continue; // The user already rated the item.
+
+        // Is the estimated value better than the worst candidate?
+        if (best.size() < numRecs)
+          best.push(Candidate(averages[j], j));
+        else if (numRecs > 0 && averages[j] > best.top().first)
         {
-          if (value <= values(insertPosition - 1, i))
-            break; // The current value is the right one.
-          insertPosition--;
+          best.pop();
+          best.push(Candidate(averages[j], j));
         }
+      }
 
-        // Now insert it into the list.
-        InsertNeighbor(i, insertPosition, j, value, recommendations,
-            values);
+      // Unmark the rated items for the next user.
+      for (size_t l = cleanedData.col_ptrs[user];
+           l < cleanedData.col_ptrs[user + 1]; ++l)
+        rated[cleanedData.row_indices[l]] = false;
+
+      // If we were not able to come up with enough recommendations, issue a
+      // warning.
+      if (best.size() < numRecs)
+      {
+        #pragma omp critical
+        Log::Warn << "Could not provide " << numRecs << " recommendations "
+            << "for user " << user << " (not enough un-rated items)!"
+            << std::endl;
+      }
+
+      // The heap gives the candidates from worst to best.
+      for (size_t pos = best.size(); pos > 0; --pos)
+      {
+        recommendations(pos - 1, i) = best.top().second;
+        best.pop();
       }
     }
+  }
+}
+
+template<typename FactorizerType>
+void CF<FactorizerType>::AddRatings(const arma::mat& newData,
+                                    const size_t iterations,
+                                    const double lambda)
+{
+  if (newData.n_rows != 3)
+  {
+    Log::Fatal << "CF::AddRatings(): ratings should have 3 rows (user, item, "
+        << "rating), but " << newData.n_rows << " were given!" << std::endl;
+  }
+
+  if (newData.n_cols == 0)
+    return;
+
+  // Group the new ratings by user; a later rating of the same item replaces an
+  // earlier one.
+  typedef std::map<size_t, double> UserRatings;
+  std::map<size_t, UserRatings> newRatings;
+  size_t numItems = cleanedData.n_rows;
+  size_t numUsers = cleanedData.n_cols;
+  for (size_t i = 0; i < newData.n_cols; ++i)
+  {
+    const size_t user = (size_t) newData(0, i);
+    const size_t item = (size_t) newData(1, i);
+    newRatings[user][item] = newData(2, i);
 
-    // If we were not able to come up with enough recommendations, issue a
-    // warning.
-    if (recommendations(values.n_rows - 1, i) == cleanedData.n_rows + 1)
-      Log::Warn << "Could not provide " << values.n_rows << " recommendations "
-          << "for user " << users(i) << " (not enough un-rated items)!" << std::endl;
+    numItems = std::max(numItems, item + 1);
+    numUsers = std::max(numUsers, user + 1);
+  }
+
+  // Merge the new ratings into the columns of the sparse matrix.  Only the
+  // columns of the affected users change, so this is a single copy of the
+  // existing ratings.
+  size_t replaced = 0;
+  std::vector<arma::uword> rowIndices;
+  std::vector<double> values;
+  arma::uvec colPtrs(numUsers + 1);
+  rowIndices.reserve(cleanedData.n_nonzero + newData.n_cols);
+  values.reserve(cleanedData.n_nonzero + newData.n_cols);
+  colPtrs[0] = 0;
+  for (size_t user = 0; user < numUsers; ++user)
+  {
+    size_t l = (user < cleanedData.n_cols) ? cleanedData.col_ptrs[user] : 0;
+    const size_t end = (user < cleanedData.n_cols) ?
+        cleanedData.col_ptrs[user + 1] : 0;
+
+    typename std::map<size_t, UserRatings>::const_iterator it =
+        newRatings.find(user);
+    if (it != newRatings.end())
+    {
+      UserRatings::const_iterator r = it->second.begin();
+      while (l < end || r != it->second.end())
+      {
+        if (r == it->second.end() || (l < end &&
+            (size_t) cleanedData.row_indices[l] < r->first))
+        {
+          rowIndices.push_back(cleanedData.row_indices[l]);
+          values.push_back(cleanedData.values[l]);
+          ++l;
+        }
+        else
+        {
+          if (l < end && (size_t) cleanedData.row_indices[l] == r->first)
+          {
+            ++replaced;
+            ++l;
+          }
+
+          rowIndices.push_back(r->first);
+          values.push_back(r->second);
+          ++r;
+        }
+      }
+    }
+    else
+    {
+      for (; l < end; ++l)
+      {
+        rowIndices.push_back(cleanedData.row_indices[l]);
+        values.push_back(cleanedData.values[l]);
+      }
+    }
+
+    colPtrs[user + 1] = rowIndices.size();
+  }
+
+  const size_t oldItems = cleanedData.n_rows;
+  cleanedData = arma::sp_mat(arma::uvec(rowIndices), colPtrs,
+      arma::vec(values), numItems, numUsers);
+
+  // Keep the (user, item, rating) table consistent with the sparse matrix, so
+  // that the model can be saved and loaded.  Replaced ratings are updated in
+  // place; this needs a pass over the table, but only if there are any.
+  if (replaced > 0)
+  {
+    for (size_t i = 0; i < data.n_cols; ++i)
+    {
+      typename std::map<size_t, UserRatings>::iterator it =
+          newRatings.find((size_t) data(0, i));
+      if (it == newRatings.end())
+        continue;
+
+      UserRatings::iterator r = it->second.find((size_t) data(1, i));
+      if (r != it->second.end())
+      {
+        data(2, i) = r->second;
+        it->second.erase(r);
+      }
+    }
+  }
+
+  arma::mat table(3, newData.n_cols);
+  size_t column = 0;
+  for (typename std::map<size_t, UserRatings>::const_iterator it =
+       newRatings.begin(); it != newRatings.end(); ++it)
+  {
+    for (UserRatings::const_iterator r = it->second.begin();
+         r != it->second.end(); ++r)
+    {
+      table(0, column) = it->first;
+      table(1, column) = r->first;
+      table(2, column) = r->second;
+      ++column;
+    }
+  }
+  if (column > 0)
+    data = arma::join_rows(data, table.cols(0, column - 1));
+
+  // If there is no model yet, it will be trained from scratch when it is
+  // needed.
+  if (w.n_elem == 0 || h.n_elem == 0)
+    return;
+
+  // New users and items start with zero factors.
+  const size_t oldUsers = h.n_cols;
+  w.resize(numItems, w.n_cols);
+  h.resize(h.n_rows, numUsers);
+
+  // The users whose factors will be solved for, and the ratings of the new
+  // items (which can only come from the new ratings).
+  arma::Col<size_t> affectedUsers(newRatings.size());
+  std::vector<std::vector<std::pair<size_t, double> > > itemRatings(numItems -
+      oldItems);
+  size_t u = 0;
+  for (typename std::map<size_t, UserRatings>::const_iterator it =
+       newRatings.begin(); it != newRatings.end(); ++it)
+    affectedUsers[u++] = it->first;
+
+  for (size_t user = 0; user < affectedUsers.n_elem; ++user)
+  {
+    for (size_t l = cleanedData.col_ptrs[affectedUsers[user]];
+         l < cleanedData.col_ptrs[affectedUsers[user] + 1]; ++l)
+    {
+      const size_t item = cleanedData.row_indices[l];
+      if (item >= oldItems)
+        itemRatings[item - oldItems].push_back(std::make_pair(
+            (size_t) affectedUsers[user], (double) cleanedData.values[l]));
+    }
+  }
+
+  // Alternate between the factors of the affected users and of the new items,
+  // solving a ridge regression for each with the other side held fixed.  The
+  // factors of all other users and items do not change.
+  const arma::mat regularizer = lambda * arma::eye<arma::mat>(w.n_cols,
+      w.n_cols);
+  for (size_t iteration = 0; iteration < iterations; ++iteration)
+  {
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t i = 0; i < affectedUsers.n_elem; ++i)
+    {
+      const size_t user = affectedUsers[i];
+      arma::mat gram = regularizer;
+      arma::vec rhs = arma::zeros<arma::vec>(w.n_cols);
+      for (size_t l = cleanedData.col_ptrs[user];
+           l < cleanedData.col_ptrs[user + 1]; ++l)
+      {
+        const arma::rowvec item = w.row(cleanedData.row_indices[l]);
+        gram += trans(item) * item;
+        rhs += cleanedData.values[l] * trans(item);
+      }
+
+      h.col(user) = solve(gram, rhs);
+    }
+
+    // Without new items, the factors of the users are already optimal.
+    if (itemRatings.empty())
+      break;
+
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t i = 0; i < itemRatings.size(); ++i)
+    {
+      arma::mat gram = regularizer;
+      arma::vec rhs = arma::zeros<arma::vec>(h.n_rows);
+      for (size_t j = 0; j < itemRatings[i].size(); ++j)
+      {
+        const arma::vec user = h.col(itemRatings[i][j].first);
+        gram += user * trans(user);
+        rhs += itemRatings[i][j].second * user;
+      }
+
+      w.row(oldItems + i) = trans(solve(gram, rhs));
+    }
+  }
+
+  Log::Info << "Folded " << newData.n_cols << " ratings of "
+      << affectedUsers.n_elem << " users (" << (numUsers - oldUsers) << " new) "
+      << "and " << (numItems - oldItems) << " new items into the model."
+      << std::endl;
+
+  // Update the neighborhoods of the affected users.  The neighborhoods of the
+  // other users are kept; Train() recomputes all of them.
+  if (neighborhood.n_elem == 0)
+    return;
+
+  if (numItems > oldItems)
+  {
+    // The new rows of w change its R factor: R' is the R factor of [R; w_new],
+    // since both have the same Gram matrix w'^T w'.  Every user moves in the
+    // new space.
+    arma::mat q, r;
+    arma::qr_econ(q, r, arma::join_cols(wFactor, w.rows(oldItems,
+        numItems - 1)));
+    wFactor = r;
+    userFactors = wFactor * h;
+  }
+  else
+  {
+    // Only the affected users and the new users move.
+    userFactors.resize(userFactors.n_rows, numUsers);
+    for (size_t i = 0; i < affectedUsers.n_elem; ++i)
+      userFactors.col(affectedUsers[i]) = wFactor * h.col(affectedUsers[i]);
+    for (size_t user = oldUsers; user < numUsers; ++user)
+      userFactors.col(user) = wFactor * h.col(user);
+  }
+
+  // Every new user gets a neighborhood, including users without ratings (whose
+  // IDs are only below the largest new ID).
+  std::vector<size_t> queryUsers(affectedUsers.begin(), affectedUsers.end());
+  for (size_t user = oldUsers; user < numUsers; ++user)
+    if (newRatings.find(user) == newRatings.end())
+      queryUsers.push_back(user);
+
+  neighborhood.resize(neighborhood.n_rows, numUsers);
+  UpdateNeighborhoods(queryUsers);
+}
+
+template<typename FactorizerType>
+void CF<FactorizerType>::UpdateNeighborhoods(const std::vector<size_t>& users)
+{
+  const size_t k = neighborhood.n_rows;
+  const arma::rowvec norms = arma::sum(arma::square(userFactors), 0);
+
+  #pragma omp parallel
+  {
+    arma::rowvec distances(userFactors.n_cols);
+    std::vector<std::pair<double, size_t> > candidates(userFactors.n_cols);
+
+    #pragma omp for schedule(dynamic)
+    for (size_t i = 0; i < users.size(); ++i)
+    {
+      const size_t user = users[i];
+      distances = norms + norms[user] - 2 * trans(userFactors.col(user)) *
+          userFactors;
+
+      // Rounding can make the distances very slightly negative.  The user is
+      // the first member of its own neighborhood, as in ComputeNeighborhood().
+      for (size_t j = 0; j < candidates.size(); ++j)
+        candidates[j] = std::make_pair(std::max(distances[j], 0.0), j);
+      candidates[user].first = -1.0;
+
+      std::partial_sort(candidates.begin(), candidates.begin() + k,
+          candidates.end());
+      for (size_t j = 0; j < k; ++j)
+        neighborhood(j, user) = candidates[j].second;
+    }
   }
 }
 
@@ -193,37 +515,56 @@ void CF<FactorizerType>::CleanData()
   cleanedData = arma::sp_mat(locations, values, maxItemID, maxUserID);
 }
 
-/**
- * Helper function to insert a point into the recommendation matrices.
- *
- * @param queryIndex Index of point whose recommendations we are inserting into.
- * @param pos Position in list to insert into.
- * @param neighbor Index of item being inserted as a recommendation.
- * @param value Value of recommendation.
- */
+// Save the trained model to a file.
+template<typename FactorizerType>
+void CF<FactorizerType>::Save(const std::string& filename) const
+{
+  if (w.n_elem == 0 || h.n_elem == 0)
+  {
+    Log::Warn << "CF::Save(): model has not been trained; not saving to '"
+        << filename << "'." << std::endl;
+    return;
+  }
+
+  util::SaveRestoreUtility save;
+  save.SaveParameter(numUsersForSimilarity, "numUsersForSimilarity");
+  save.SaveParameter(rank, "rank");
+  save.SaveParameter(data, "data");
+  save.SaveParameter(w, "w");
+  save.SaveParameter(h, "h");
+
+  if (!save.WriteFile(filename))
+    Log::Warn << "CF::Save(): error saving to '" << filename << "'.\n";
+}
+
+// Load a trained model from a file.
 template<typename FactorizerType>
-void CF<FactorizerType>::InsertNeighbor(const size_t queryIndex,
-                                        const size_t pos,
-                                        const size_t neighbor,
-                                        const double value,
-                                        arma::Mat<size_t>& recommendations,
-                                        arma::mat& values) const
+void CF<FactorizerType>::Load(const std::string& filename)
 {
-  // We only memmove() if there is actually a need to shift something.
-  if (pos < (recommendations.n_rows - 1))
+  util::SaveRestoreUtility load;
+
+  if (!load.ReadFile(filename))
+    Log::Fatal << "CF::Load(): could not read file '" << filename << "'!\n";
+
+  load.LoadParameter(numUsersForSimilarity, "numUsersForSimilarity");
+  load.LoadParameter(rank, "rank");
+  load.LoadParameter(data, "data");
+  load.LoadParameter(w, "w");
+  load.LoadParameter(h, "h");
+
+  CleanData();
+
+  // We need to do a little error checking here.
+  if (w.n_rows != cleanedData.n_rows || h.n_cols != cleanedData.n_cols ||
+      w.n_cols != h.n_rows)
   {
-    const int len = (values.n_rows - 1) - pos;
-    memmove(values.colptr(queryIndex) + (pos + 1),
-        values.colptr(queryIndex) + pos,
-        sizeof(double) * len);
-    memmove(recommendations.colptr(queryIndex) + (pos + 1),
-        recommendations.colptr(queryIndex) + pos,
-        sizeof(size_t) * len);
+    Log::Fatal << "CF::Load('" << filename << "'): factors of size "
+        << w.n_rows << "x" << w.n_cols << " and " << h.n_rows << "x"
+        << h.n_cols << " do not match the " << cleanedData.n_rows << " items "
+        << "and " << cleanedData.n_cols << " users in the data!" << std::endl;
   }
 
-  // Now put the new information in the right index.
-  values(pos, queryIndex) = value;
-  recommendations(pos, queryIndex) = neighbor;
+  ComputeNeighborhood();
 }
 
 // Return string of object.
@@ -267,6 +267,18 @@ class GMM
   double Probability(const arma::vec& observation,
                      const size_t component) const;
 
+  /**
+   * Calculate the log-probability of each of the given observations (one per
+   * column) under this distribution, storing the results in the given vector.
+   * The components are evaluated on the whole matrix at once and combined in
+   * log-space, so this does not underflow for unlikely observations.
+   *
+   * @param observations List of observations.
+   * @param logProbabilities Output log-probabilities for each observation.
+   */
+  void LogProbability(const arma::mat& observations,
+                      arma::vec& logProbabilities) const;
+
   /**
    * Return a randomly generated observation according to the probability
    * distribution defined by this object.
@@ -275,6 +287,18 @@ class GMM
    */
   arma::vec Random() const;
 
+  /**
+   * Generate the given number of random observations according to the
+   * probability distribution defined by this object.  The component of each
+   * observation is chosen first; then the observations of each component are
+   * generated together, with a single Cholesky decomposition and a single
+   * matrix multiplication per component.
+   *
+   * @param samples Number of observations to generate.
+   * @return Matrix of random observations from this GMM, one per column.
+   */
+  arma::mat Random(const size_t samples) const;
+
   /**
    * Estimate the probability distribution directly from the given observations,
    * using the given algorithm in the FittingType class to fit the data.
@@ -343,6 +367,11 @@ class GMM
    * double priorWeight = gmm.Weights()[2];
    * @endcode
    *
+   * The factorization of each covariance matrix is computed once per call and
+   * reused for every observation, and the observations are processed in
+   * blocks, which are distributed between threads if mlpack is compiled with
+   * OpenMP support.
+   *
    * @param observations List of observations to classify.
    * @param labels Object which will be filled with labels.
    */
@@ -369,6 +398,46 @@ class GMM
                        const std::vector<arma::mat>& covars,
                        const arma::vec& weights) const;
 
+  /**
+   * Compute the factors which are needed to evaluate the weighted
+   * log-probability of each component many times: the inverse of the lower
+   * triangular Cholesky factor of each covariance, and the logarithm of the
+   * product of each weight and normalizing constant.  If a covariance is not
+   * positive definite, its inverse is stored instead of the whitening matrix,
+   * and its determinant is used for the normalizing constant.
+   *
+   * @param whiteners Vector to store the inverse Cholesky factors (or the
+   *     inverse covariances) in.
+   * @param definite Vector to store whether each covariance is positive
+   *     definite in.
+   * @param logConstants Vector to store the log-constants in.
+   */
+  void ComponentFactors(std::vector<arma::mat>& whiteners,
+                        std::vector<bool>& definite,
+                        arma::vec& logConstants) const;
+
+  /**
+   * Compute the weighted log-probability of each observation under each
+   * component, using the factors given by ComponentFactors().  Row i of the
+   * output corresponds to component i.
+   *
+   * @param observations Observations to evaluate.
+   * @param whiteners Inverse Cholesky factors (or inverse covariances) of each
+   *     component.
+   * @param definite Whether each covariance is positive definite.
+   * @param logConstants Log-constants of each component.
+   * @param logLikelihoods Matrix to store the log-probabilities in.
+   */
+  void ComponentLogLikelihoods(const arma::mat& observations,
+                               const std::vector<arma::mat>& whiteners,
+                               const std::vector<bool>& definite,
+                               const arma::vec& logConstants,
+                               arma::mat& logLikelihoods) const;
+
+  //! Number of observations processed together by Classify() and
+  //! LogProbability().
+  static const size_t blockSize = 1024;
+
   //! Locally-stored fitting object; in case the user did not pass one.
   FittingType localFitter;
 
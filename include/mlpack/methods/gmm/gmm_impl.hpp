@@ -229,6 +229,48 @@ double GMM<FittingType>::Probability(const arma::vec& observation,
       phi(observation, means[component], covariances[component]);
 }
 
+/**
+ * Return the log-probability of each of the given observations being from this
+ * GMM.
+ */
+template<typename FittingType>
+void GMM<FittingType>::LogProbability(const arma::mat& observations,
+                                      arma::vec& logProbabilities) const
+{
+  std::vector<arma::mat> whiteners;
+  std::vector<bool> definite;
+  arma::vec logConstants;
+  ComponentFactors(whiteners, definite, logConstants);
+
+  logProbabilities.set_size(observations.n_cols);
+  const size_t blocks = (observations.n_cols + blockSize - 1) / blockSize;
+
+  #pragma omp parallel
+  {
+    arma::mat logLikelihoods;
+
+    #pragma omp for schedule(static)
+    for (size_t block = 0; block < blocks; ++block)
+    {
+      const size_t begin = block * blockSize;
+      const size_t end = std::min(begin + blockSize, (size_t)
+          observations.n_cols) - 1;
+
+      // Row i holds the log-probabilities of each point under Gaussian i,
+      // including the prior for that Gaussian.
+      ComponentLogLikelihoods(observations.cols(begin, end), whiteners,
+          definite, logConstants, logLikelihoods);
+
+      // Sum the probabilities of each component in log-space; the largest term
+      // is factored out so that the exponentials cannot all underflow.
+      const arma::rowvec maxLogLikelihoods = arma::max(logLikelihoods, 0);
+      logLikelihoods.each_row() -= maxLogLikelihoods;
+      logProbabilities.subvec(begin, end) = trans(maxLogLikelihoods +
+          log(arma::sum(exp(logLikelihoods), 0)));
+    }
+  }
+}
+
 /**
  * Return a randomly generated observation according to the probability
  * distribution defined by this object.
@@ -255,6 +297,43 @@ arma::vec GMM<FittingType>::Random() const
       arma::randn<arma::vec>(dimensionality) + means[gaussian];
 }
 
+/**
+ * Return a matrix of randomly generated observations according to the
+ * probability distribution defined by this object.
+ */
+template<typename FittingType>
+arma::mat GMM<FittingType>::Random(const size_t samples) const
+{
+  // Determine which Gaussian each observation will be coming from, in the same
+  // way as the single-observation Random() does.
+  const arma::vec cumulativeWeights = arma::cumsum(weights);
+  arma::uvec components(samples);
+  for (size_t i = 0; i < samples; ++i)
+  {
+    const double gaussRand = math::Random();
+    const double* position = std::lower_bound(cumulativeWeights.begin(),
+        cumulativeWeights.end(), gaussRand);
+    components[i] = (position == cumulativeWeights.end()) ? 0 :
+        (position - cumulativeWeights.begin());
+  }
+
+  // Now generate all of the observations from each Gaussian at once.
+  arma::mat result(dimensionality, samples);
+  for (size_t g = 0; g < gaussians; ++g)
+  {
+    const arma::uvec indices = arma::find(components == g);
+    if (indices.n_elem == 0)
+      continue;
+
+    arma::mat gaussianSamples = trans(chol(covariances[g])) *
+        arma::randn<arma::mat>(dimensionality, indices.n_elem);
+    gaussianSamples.each_col() += means[g];
+    result.cols(indices) = gaussianSamples;
+  }
+
+  return result;
+}
+
 /**
  * Fit the GMM to the given observations.
  */
@@ -443,27 +522,107 @@ template<typename FittingType>
 void GMM<FittingType>::Classify(const arma::mat& observations,
                                 arma::Col<size_t>& labels) const
 {
-  // This is not the best way to do this!
+  std::vector<arma::mat> whiteners;
+  std::vector<bool> definite;
+  arma::vec logConstants;
+  ComponentFactors(whiteners, definite, logConstants);
 
-  // We should not have to fill this with values, because each one should be
-  // overwritten.
   labels.set_size(observations.n_cols);
-  for (size_t i = 0; i < observations.n_cols; ++i)
+  const size_t blocks = (observations.n_cols + blockSize - 1) / blockSize;
+
+  // Each block of observations is independent, so the blocks are split between
+  // threads.
+  #pragma omp parallel
   {
-    // Find maximum probability component.
-    double probability = 0;
-    for (size_t j = 0; j < gaussians; ++j)
+    arma::mat logLikelihoods;
+
+    #pragma omp for schedule(static)
+    for (size_t block = 0; block < blocks; ++block)
     {
-      double newProb = Probability(observations.unsafe_col(i), j);
-      if (newProb >= probability)
+      const size_t begin = block * blockSize;
+      const size_t end = std::min(begin + blockSize, (size_t)
+          observations.n_cols) - 1;
+
+      // The most probable component for each point is the one with the largest
+      // weighted log-probability.
+      ComponentLogLikelihoods(observations.cols(begin, end), whiteners,
+          definite, logConstants, logLikelihoods);
+
+      for (size_t i = 0; i < logLikelihoods.n_cols; ++i)
       {
-        probability = newProb;
-        labels[i] = j;
+        arma::uword maxIndex;
+        logLikelihoods.unsafe_col(i).max(maxIndex);
+        labels[begin + i] = maxIndex;
       }
     }
   }
 }
 
+/**
+ * Compute the factors needed to evaluate the weighted log-probability of each
+ * component.
+ */
+template<typename FittingType>
+void GMM<FittingType>::ComponentFactors(std::vector<arma::mat>& whiteners,
+                                        std::vector<bool>& definite,
+                                        arma::vec& logConstants) const
+{
+  whiteners.resize(gaussians);
+  definite.resize(gaussians);
+  logConstants.set_size(gaussians);
+  for (size_t i = 0; i < gaussians; ++i)
+  {
+    // With cov = L * L', the Mahalanobis distance of x is the squared norm of
+    // L^-1 * (x - mean).
+    arma::mat lower;
+    definite[i] = LowerCholesky(covariances[i], lower);
+    double logDetCov;
+    if (definite[i])
+    {
+      whiteners[i] = inv(arma::trimatl(lower));
+      logDetCov = 2.0 * accu(log(lower.diag()));
+    }
+    else
+    {
+      // The covariance is not positive definite, so fall back to its inverse
+      // and determinant, as LogPhi() does; they are only computed once.
+      whiteners[i] = inv(covariances[i]);
+      logDetCov = log(det(covariances[i]));
+    }
+
+    logConstants[i] = log(weights[i]) - 0.5 * ((double) dimensionality *
+        log(2 * M_PI) + logDetCov);
+  }
+}
+
+/**
+ * Compute the weighted log-probability of each observation under each
+ * component.
+ */
+template<typename FittingType>
+void GMM<FittingType>::ComponentLogLikelihoods(
+    const arma::mat& observations,
+    const std::vector<arma::mat>& whiteners,
+    const std::vector<bool>& definite,
+    const arma::vec& logConstants,
+    arma::mat& logLikelihoods) const
+{
+  logLikelihoods.set_size(gaussians, observations.n_cols);
+
+  arma::mat diffs;
+  for (size_t i = 0; i < gaussians; ++i)
+  {
+    diffs = observations;
+    diffs.each_col() -= means[i];
+    if (definite[i])
+      logLikelihoods.row(i) = logConstants[i] -
+          0.5 * arma::sum(arma::square(whiteners[i] * diffs), 0);
+    else
+      logLikelihoods.row(i) = logConstants[i] -
+          0.5 * arma::sum(diffs % (whiteners[i] * diffs), 0);
+  }
+}
+
 /**
  * Get the log-likelihood of this data's fit to the model.
  */
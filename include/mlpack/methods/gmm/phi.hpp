@@ -125,6 +125,93 @@ inline double phi(const arma::vec& x,
   return f;
 }
 
+/**
+ * Computes the lower triangular Cholesky factor L of a symmetric matrix, so
+ * that cov = L * L'.  Unlike arma::chol(), this does not print an error when
+ * the matrix is not positive definite; it just returns false, so that callers
+ * can quietly fall back to another method.
+ *
+ * @param cov Symmetric matrix to factorize.
+ * @param lower Output lower triangular factor.
+ * @return Whether the matrix is positive definite.
+ */
+inline bool LowerCholesky(const arma::mat& cov, arma::mat& lower)
+{
+  const size_t n = cov.n_rows;
+  if (n == 0 || cov.n_cols != n)
+    return false;
+
+  lower.zeros(n, n);
+  for (size_t j = 0; j < n; ++j)
+  {
+    double pivot = cov(j, j);
+    if (j > 0)
+      pivot -= dot(lower.submat(j, 0, j, j - 1), lower.submat(j, 0, j, j - 1));
+
+    // This also catches NaNs.
+    if (!(pivot > 0))
+      return false;
+
+    lower(j, j) = sqrt(pivot);
+    if (j + 1 < n)
+    {
+      arma::vec column = cov.submat(j + 1, j, n - 1, j);
+      if (j > 0)
+        column -= lower.submat(j + 1, 0, n - 1, j - 1) *
+            trans(lower.submat(j, 0, j, j - 1));
+      lower.submat(j + 1, j, n - 1, j) = column / lower(j, j);
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Calculates the logarithm of the multivariate Gaussian probability density
+ * function for each data point (column) in the given matrix, with respect to
+ * the given mean and variance.  This works on the whole matrix at once: the
+ * covariance is factorized a single time with a Cholesky decomposition, and
+ * the Mahalanobis distances of all points are found with one triangular solve.
+ * Working in log-space also avoids underflow for points far from the mean.
+ *
+ * @param x List of observations.
+ * @param mean Mean of multivariate Gaussian.
+ * @param cov Covariance of multivariate Gaussian.
+ * @param logProbabilities Output log-probabilities for each input observation.
+ */
+inline void LogPhi(const arma::mat& x,
+                   const arma::vec& mean,
+                   const arma::mat& cov,
+                   arma::vec& logProbabilities)
+{
+  // Column i of 'diffs' is the difference between x.col(i) and the mean.
+  arma::mat diffs = x;
+  diffs.each_col() -= mean;
+
+  // With cov = L * L', the Mahalanobis distance of each point is the squared
+  // norm of the corresponding column of L^-1 * diffs, and the log of the
+  // determinant of the covariance is twice the sum of the logs of diag(L).
+  arma::mat lower;
+  arma::rowvec distances;
+  double logDetCov;
+  if (LowerCholesky(cov, lower))
+  {
+    const arma::mat whitened = arma::solve(arma::trimatl(lower), diffs);
+    distances = arma::sum(arma::square(whitened), 0);
+    logDetCov = 2.0 * accu(log(lower.diag()));
+  }
+  else
+  {
+    // The covariance is not positive definite, so we fall back to the direct
+    // computation that phi() uses.
+    distances = arma::sum(diffs % (inv(cov) * diffs), 0);
+    logDetCov = log(det(cov));
+  }
+
+  logProbabilities = -0.5 * ((double) mean.n_elem * log(2 * M_PI) + logDetCov
+      + trans(distances));
+}
+
 /**
  * Calculates the multivariate Gaussian probability density function for each
  * data point (column) in the given matrix, with respect to the given mean and
@@ -140,20 +227,8 @@ inline void phi(const arma::mat& x,
                 const arma::mat& cov,
                 arma::vec& probabilities)
 {
-  // Column i of 'diffs' is the difference between x.col(i) and the mean.
-  arma::mat diffs = x - (mean * arma::ones<arma::rowvec>(x.n_cols));
-
-  // Now, we only want to calculate the diagonal elements of (diffs' * cov^-1 *
-  // diffs).  We just don't need any of the other elements.  We can calculate
-  // the right hand part of the equation (instead of the left side) so that
-  // later we are referencing columns, not rows -- that is faster.
-  arma::mat rhs = -0.5 * inv(cov) * diffs;
-  arma::vec exponents(diffs.n_cols); // We will now fill this.
-  for (size_t i = 0; i < diffs.n_cols; i++)
-    exponents(i) = exp(accu(diffs.unsafe_col(i) % rhs.unsafe_col(i)));
-
-  probabilities = pow(2 * M_PI, (double) mean.n_elem / -2.0) *
-      pow(det(cov), -0.5) * exponents;
+  LogPhi(x, mean, cov, probabilities);
+  probabilities = exp(probabilities);
 }
 
 }; // namespace gmm
@@ -48,6 +48,11 @@ namespace hmm /** Hidden Markov Models. */ {
  *   // Return the probability of the given observation.
  *   double Probability(const DataType& observation) const;
  *
+ *   // Compute the log-probability of each observation (column) in the given
+ *   // matrix.
+ *   void LogProbability(const arma::mat& observations,
+ *                       arma::vec& logProbabilities) const;
+ *
  *   // Estimate the distribution based on the given observations.
  *   void Estimate(const std::vector<DataType>& observations);
  *
@@ -62,7 +67,7 @@ namespace hmm /** Hidden Markov Models. */ {
  * would use the DiscreteDistribution class when the observations are
  * non-negative integers.  Other distributions could be Gaussians, a mixture of
  * Gaussians (GMM), or any other probability distribution implementing the
- * four Distribution functions.
+ * five Distribution functions.
  *
  * Usage of the HMM class generally involves either training an HMM or loading
  * an already-known HMM and taking probability measurements of sequences.
@@ -86,6 +91,8 @@ namespace hmm /** Hidden Markov Models. */ {
  * (with LogLikelihood()), predict the most likely sequence of hidden states
  * (with Predict()), generate a sequence (with Generate()), or estimate the
  * probabilities of each state for a sequence of observations (with Estimate()).
+ * To process observations one at a time as they arrive, use the HMMFilter
+ * class.
  *
  * @tparam Distribution Type of emission distribution for this HMM.
  */
@@ -166,6 +173,9 @@ class HMM
    * log-likelihood of the model between iterations is less than the tolerance,
    * the Baum-Welch algorithm terminates.
    *
+   * If mlpack is compiled with OpenMP support, the E-step of each iteration
+   * processes the data sequences in parallel.
+   *
    * @note
    * Train() can be called multiple times with different sequences; each time it
    * is called, it uses the current parameters of the HMM as a starting point
@@ -267,6 +277,24 @@ class HMM
   double Predict(const arma::mat& dataSeq,
                  arma::Col<size_t>& stateSeq) const;
 
+  /**
+   * Compute the most probable hidden state sequence for each of the given data
+   * sequences, using the Viterbi algorithm.  This is equivalent to calling
+   * Predict() on each sequence, but the work buffers are allocated only once
+   * per thread and, if mlpack is compiled with OpenMP support, the sequences
+   * are decoded in parallel.  The log-likelihood of the most probable state
+   * sequence for dataSeq[i] is stored in logLikelihood[i].
+   *
+   * @param dataSeq Vector of observation sequences.
+   * @param stateSeq Vector in which the most probable state sequences will be
+   *    stored.
+   * @param logLikelihood Vector in which the log-likelihood of each most
+   *    probable state sequence will be stored.
+   */
+  void Predict(const std::vector<arma::mat>& dataSeq,
+               std::vector<arma::Col<size_t> >& stateSeq,
+               arma::vec& logLikelihood) const;
+
   /**
    * Compute the log-likelihood of the given data sequence.
    *
@@ -308,32 +336,80 @@ class HMM
  private:
   // Helper functions.
 
+  /**
+   * Compute the probability of each observation in the given data sequence
+   * under each emission distribution.  The returned matrix has rows equal to
+   * the number of hidden states and columns equal to the number of
+   * observations, so that emissionProb(j, t) is the probability of observation
+   * t being emitted by state j.
+   *
+   * @param dataSeq Data sequence to compute emission probabilities for.
+   * @param emissionProb Matrix in which emission probabilities will be saved.
+   */
+  void EmissionProbability(const arma::mat& dataSeq,
+                           arma::mat& emissionProb) const;
+
+  /**
+   * Compute the log-probability of each observation in the given data sequence
+   * under each emission distribution.  The returned matrix has the same layout
+   * as the one given by EmissionProbability().
+   *
+   * @param dataSeq Data sequence to compute emission log-probabilities for.
+   * @param logEmissionProb Matrix in which emission log-probabilities will be
+   *    saved.
+   */
+  void LogEmissionProbability(const arma::mat& dataSeq,
+                              arma::mat& logEmissionProb) const;
+
+  /**
+   * Run the Viterbi algorithm on the given data sequence, using the given work
+   * buffers.  The buffers are resized to the length of the sequence; when they
+   * are reused for sequences of the same length, no allocation takes place.
+   *
+   * @param dataSeq Sequence of observations.
+   * @param logTrans Logarithm of the transposed transition matrix.
+   * @param stateSeq Vector in which the most probable state sequence will be
+   *    stored.
+   * @param logEmissionProb Buffer for emission log-probabilities.
+   * @param logStateProb Buffer for log-probabilities of the best paths.
+   * @param stateSeqBack Buffer for the backpointers of the best paths.
+   * @return Log-likelihood of most probable state sequence.
+   */
+  double Viterbi(const arma::mat& dataSeq,
+                 const arma::mat& logTrans,
+                 arma::Col<size_t>& stateSeq,
+                 arma::mat& logEmissionProb,
+                 arma::mat& logStateProb,
+                 arma::Mat<size_t>& stateSeqBack) const;
+
   /**
    * The Forward algorithm (part of the Forward-Backward algorithm).  Computes
-   * forward probabilities for each state for each observation in the given data
-   * sequence.  The returned matrix has rows equal to the number of hidden
-   * states and columns equal to the number of observations.
+   * forward probabilities for each state for each observation, given the
+   * emission probabilities of the data sequence (as computed by
+   * EmissionProbability()).  The returned matrix has rows equal to the number
+   * of hidden states and columns equal to the number of observations.
    *
-   * @param dataSeq Data sequence to compute probabilities for.
+   * @param emissionProb Emission probabilities of the data sequence.
    * @param scales Vector in which scaling factors will be saved.
    * @param forwardProb Matrix in which forward probabilities will be saved.
    */
-  void Forward(const arma::mat& dataSeq,
+  void Forward(const arma::mat& emissionProb,
                arma::vec& scales,
                arma::mat& forwardProb) const;
 
   /**
    * The Backward algorithm (part of the Forward-Backward algorithm).  Computes
-   * backward probabilities for each state for each observation in the given
-   * data sequence, using the scaling factors found (presumably) by Forward().
-   * The returned matrix has rows equal to the number of hidden states and
-   * columns equal to the number of observations.
+   * backward probabilities for each state for each observation, given the
+   * emission probabilities of the data sequence (as computed by
+   * EmissionProbability()) and the scaling factors found (presumably) by
+   * Forward().  The returned matrix has rows equal to the number of hidden
+   * states and columns equal to the number of observations.
    *
-   * @param dataSeq Data sequence to compute probabilities for.
+   * @param emissionProb Emission probabilities of the data sequence.
    * @param scales Vector of scaling factors.
    * @param backwardProb Matrix in which backward probabilities will be saved.
    */
-  void Backward(const arma::mat& dataSeq,
+  void Backward(const arma::mat& emissionProb,
                 const arma::vec& scales,
                 arma::mat& backwardProb) const;
 
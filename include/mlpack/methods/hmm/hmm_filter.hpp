@@ -0,0 +1,135 @@
+/**
+ * @file hmm_filter.hpp
+ *
+ * Definition of the HMMFilter class, which performs online forward filtering
+ * with a trained HMM.
+ *
+ * This file is part of MLPACK 1.0.10.
+ *
+ * MLPACK is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * MLPACK is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details (LICENSE.txt).
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * MLPACK.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __MLPACK_METHODS_HMM_HMM_FILTER_HPP
+#define __MLPACK_METHODS_HMM_HMM_FILTER_HPP
+
+#include "hmm.hpp"
+
+namespace mlpack {
+namespace hmm {
+
+/**
+ * An incremental forward filter for a Hidden Markov Model.  Where
+ * HMM::Estimate() and HMM::LogLikelihood() require an entire data sequence,
+ * this class accepts observations one at a time (or in small blocks) as they
+ * arrive, and keeps only the current scaled forward probabilities and the
+ * cumulative log-likelihood of the observations seen so far.  This means that
+ * each filter uses O(states) memory, regardless of the length of the stream.
+ *
+ * The filter holds a reference to the HMM, so many filters (one per stream) may
+ * share a single trained model, and the model must outlive every filter using
+ * it.  The model should not be modified while filters are in use.
+ *
+ * After Update() has been called on each observation in a sequence, Filtered()
+ * is equal to the last column of the forward probabilities given by
+ * HMM::Estimate(), and LogLikelihood() is equal to HMM::LogLikelihood() on that
+ * sequence.
+ *
+ * @code
+ * extern HMM<GaussianDistribution> hmm; // A trained HMM.
+ * HMMFilter<GaussianDistribution> filter(hmm);
+ *
+ * extern arma::vec observation; // A newly arrived observation.
+ * filter.Update(observation);
+ * const arma::vec& stateProb = filter.Filtered(); // P(X_t | o_{1:t}).
+ * @endcode
+ *
+ * @tparam Distribution Type of emission distribution of the HMM.
+ */
+template<typename Distribution = distribution::DiscreteDistribution>
+class HMMFilter
+{
+ public:
+  /**
+   * Create a filter for the given HMM.  No observations have been seen yet.
+   *
+   * @param hmm Trained HMM to filter with.
+   */
+  HMMFilter(const HMM<Distribution>& hmm);
+
+  /**
+   * Forget all observations seen so far, so that the next observation given to
+   * Update() is treated as the start of a new sequence.
+   */
+  void Reset();
+
+  /**
+   * Incorporate the next observations of the stream, updating the filtered
+   * state probabilities and the cumulative log-likelihood.  Each column of the
+   * matrix is one observation, in time order; to add a single observation,
+   * pass it as a column vector.
+   *
+   * @param observations Next observation(s) in the stream.
+   * @return Log-likelihood of the given observations given all previous
+   *     observations.
+   */
+  double Update(const arma::mat& observations);
+
+  //! Get the filtered state probabilities P(X_t | o_{1:t}).
+  const arma::vec& Filtered() const { return forward; }
+
+  /**
+   * Compute the predicted state probabilities P(X_{t + 1} | o_{1:t}) for the
+   * next time step, before the next observation is seen.
+   *
+   * @param prediction Vector to store the predicted state probabilities in.
+   */
+  void Predict(arma::vec& prediction) const;
+
+  //! Get the log-likelihood of all observations seen so far.
+  double LogLikelihood() const { return logLikelihood; }
+  //! Get the number of observations seen so far.
+  size_t Steps() const { return steps; }
+
+  //! Get the HMM used by this filter.
+  const HMM<Distribution>& Model() const { return hmm; }
+
+ private:
+  //! The HMM used for filtering.
+  const HMM<Distribution>& hmm;
+
+  /**
+   * Advance the filter by one time step, given the probability of the new
+   * observation under each state's emission distribution.
+   *
+   * @param emissionProb Emission probabilities of the new observation.
+   * @return Log-likelihood of the observation given all previous observations.
+   */
+  double Step(const arma::vec& emissionProb);
+
+  //! The scaled forward probabilities for the current time step.
+  arma::vec forward;
+
+  //! The cumulative log-likelihood of the observations seen so far.
+  double logLikelihood;
+
+  //! The number of observations seen so far.
+  size_t steps;
+};
+
+}; // namespace hmm
+}; // namespace mlpack
+
+// Include implementation.
+#include "hmm_filter_impl.hpp"
+
+#endif
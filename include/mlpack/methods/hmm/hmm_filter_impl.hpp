@@ -0,0 +1,116 @@
+/**
+ * @file hmm_filter_impl.hpp
+ *
+ * Implementation of the HMMFilter class.
+ *
+ * This file is part of MLPACK 1.0.10.
+ *
+ * MLPACK is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * MLPACK is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details (LICENSE.txt).
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * MLPACK.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __MLPACK_METHODS_HMM_HMM_FILTER_IMPL_HPP
+#define __MLPACK_METHODS_HMM_HMM_FILTER_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "hmm_filter.hpp"
+
+namespace mlpack {
+namespace hmm {
+
+template<typename Distribution>
+HMMFilter<Distribution>::HMMFilter(const HMM<Distribution>& hmm) :
+    hmm(hmm),
+    forward(hmm.Transition().n_rows),
+    logLikelihood(0),
+    steps(0)
+{
+  Reset();
+}
+
+template<typename Distribution>
+void HMMFilter<Distribution>::Reset()
+{
+  // Before any observation, the state probabilities are the initial ones.
+  forward = hmm.Initial();
+  logLikelihood = 0;
+  steps = 0;
+}
+
+template<typename Distribution>
+double HMMFilter<Distribution>::Update(const arma::mat& observations)
+{
+  if (observations.n_rows != hmm.Dimensionality())
+  {
+    Log::Fatal << "HMMFilter::Update(): observations have dimensionality "
+        << observations.n_rows << " (expected " << hmm.Dimensionality()
+        << " dimensions)." << std::endl;
+  }
+
+  // Evaluate the emission probabilities of the whole block with one call to
+  // each distribution; a single observation is just a block of one.
+  arma::mat emissionProb(forward.n_elem, observations.n_cols);
+  arma::vec logProb;
+  for (size_t state = 0; state < forward.n_elem; state++)
+  {
+    hmm.Emission()[state].LogProbability(observations, logProb);
+    emissionProb.row(state) = trans(exp(logProb));
+  }
+
+  double blockLogLikelihood = 0;
+  for (size_t t = 0; t < observations.n_cols; t++)
+    blockLogLikelihood += Step(emissionProb.unsafe_col(t));
+
+  return blockLogLikelihood;
+}
+
+template<typename Distribution>
+void HMMFilter<Distribution>::Predict(arma::vec& prediction) const
+{
+  // If nothing has been seen, the next state is distributed as the initial
+  // state.
+  if (steps == 0)
+    prediction = hmm.Initial();
+  else
+    prediction = hmm.Transition() * forward;
+}
+
+/**
+ * One step of the Forward algorithm; see HMM::Forward().
+ */
+template<typename Distribution>
+double HMMFilter<Distribution>::Step(const arma::vec& emissionProb)
+{
+  // The first observation uses the initial state probabilities; every later
+  // observation uses the probability of the previous state transitioning to
+  // the current state.
+  if (steps > 0)
+    forward = hmm.Transition() * forward;
+
+  forward %= emissionProb;
+
+  // Normalize the probabilities; the scaling factor is the likelihood of this
+  // observation given the previous ones.
+  const double scale = accu(forward);
+  forward /= scale;
+
+  const double stepLogLikelihood = log(scale);
+  logLikelihood += stepLogLikelihood;
+  ++steps;
+
+  return stepLogLikelihood;
+}
+
+}; // namespace hmm
+}; // namespace mlpack
+
+#endif
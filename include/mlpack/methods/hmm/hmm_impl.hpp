@@ -95,10 +95,14 @@ void HMM<Distribution>::Train(const std::vector<arma::mat>& dataSeq)
   // Maximum iterations?
   size_t iterations = 1000;
 
-  // Find length of all sequences and ensure they are the correct size.
+  // Find length of all sequences and ensure they are the correct size.  We
+  // also record where each sequence starts in the concatenated list of
+  // observations, so that each sequence can be processed independently.
+  std::vector<size_t> seqOffset(dataSeq.size());
   size_t totalLength = 0;
   for (size_t seq = 0; seq < dataSeq.size(); seq++)
   {
+    seqOffset[seq] = totalLength;
     totalLength += dataSeq[seq].n_cols;
 
     if (dataSeq[seq].n_rows != dimensionality)
@@ -107,11 +111,16 @@ void HMM<Distribution>::Train(const std::vector<arma::mat>& dataSeq)
           << dimensionality << " dimensions)." << std::endl;
   }
 
-  // These are used later for training of each distribution.  We initialize it
-  // all now so we don't have to do any allocation later on.
-  std::vector<arma::vec> emissionProb(transition.n_cols,
-      arma::vec(totalLength));
+  // These are used later for training of each distribution.  The list of
+  // observations does not change between iterations, so we assemble it only
+  // once.  Row j of emissionProb holds the probability of each observation
+  // having come from state j.
+  arma::mat emissionProb(transition.n_cols, totalLength);
   arma::mat emissionList(dimensionality, totalLength);
+  for (size_t seq = 0; seq < dataSeq.size(); seq++)
+    if (dataSeq[seq].n_cols > 0)
+      emissionList.cols(seqOffset[seq],
+          seqOffset[seq] + dataSeq[seq].n_cols - 1) = dataSeq[seq];
 
   // This should be the Baum-Welch algorithm (EM for HMM estimation). This
   // follows the procedure outlined in Elliot, Aggoun, and Moore's book "Hidden
@@ -127,53 +136,74 @@ void HMM<Distribution>::Train(const std::vector<arma::mat>& dataSeq)
     // Reset log likelihood.
     loglik = 0;
 
-    // Sum over time.
-    size_t sumTime = 0;
-
-    // Loop over each sequence.
-    for (size_t seq = 0; seq < dataSeq.size(); seq++)
+    // The E-step for each sequence is independent of every other sequence, so
+    // the sequences are split between threads.  Each thread accumulates its own
+    // estimates, and these are summed once all sequences are processed.
+    #pragma omp parallel
     {
+      arma::vec threadInitial(transition.n_rows);
+      threadInitial.zeros();
+      arma::mat threadTransition(transition.n_rows, transition.n_cols);
+      threadTransition.zeros();
+      double threadLoglik = 0;
+
+      arma::mat probs;
       arma::mat stateProb;
       arma::mat forward;
       arma::mat backward;
       arma::vec scales;
 
-      // Add the log-likelihood of this sequence.  This is the E-step.
-      loglik += Estimate(dataSeq[seq], stateProb, forward, backward, scales);
-
-      // Now re-estimate the parameters.  This is the M-step.
-      //   pi_i = sum_d ((1 / P(seq[d])) sum_t (f(i, 0) b(i, 0))
-      //   T_ij = sum_d ((1 / P(seq[d])) sum_t (f(i, t) T_ij E_i(seq[d][t]) b(i,
-      //           t + 1)))
-      //   E_ij = sum_d ((1 / P(seq[d])) sum_{t | seq[d][t] = j} f(i, t) b(i, t)
-      // We store the new estimates in a different matrix.
-      for (size_t t = 0; t < dataSeq[seq].n_cols; t++)
+      #pragma omp for schedule(dynamic)
+      for (size_t seq = 0; seq < dataSeq.size(); seq++)
       {
-        for (size_t j = 0; j < transition.n_cols; j++)
+        const size_t length = dataSeq[seq].n_cols;
+        if (length == 0)
+          continue;
+
+        // Add the log-likelihood of this sequence.  This is the E-step.
+        EmissionProbability(dataSeq[seq], probs);
+        Forward(probs, scales, forward);
+        Backward(probs, scales, backward);
+        threadLoglik += accu(log(scales));
+
+        // Now re-estimate the parameters.  This is the M-step.
+        //   pi_i = sum_d ((1 / P(seq[d])) sum_t (f(i, 0) b(i, 0))
+        //   T_ij = sum_d ((1 / P(seq[d])) sum_t (f(i, t) T_ij E_i(seq[d][t])
+        //           b(i, t + 1)))
+        //   E_ij = sum_d ((1 / P(seq[d])) sum_{t | seq[d][t] = j} f(i, t)
+        //           b(i, t)
+        // The state probabilities f(i, t) b(i, t) are stored in the columns of
+        // emissionProb which belong to this sequence; no other thread writes
+        // to those columns.
+        stateProb = forward % backward;
+        emissionProb.cols(seqOffset[seq], seqOffset[seq] + length - 1) =
+            stateProb;
+        threadInitial += stateProb.unsafe_col(0);
+
+        // The estimate of T_ij (probability of transition from state j to state
+        // i) is a sum over t of outer products, which we compute as a single
+        // matrix product.  We postpone multiplication of the old T_ij until
+        // later.
+        if (length > 1)
         {
-          // Add to estimate of initial probability for state j.
-          newInitial[j] = stateProb(j, 0);
-
-          if (t < dataSeq[seq].n_cols - 1)
-          {
-            // Estimate of T_ij (probability of transition from state j to state
-            // i).  We postpone multiplication of the old T_ij until later.
-            for (size_t i = 0; i < transition.n_rows; i++)
-              newTransition(i, j) += forward(j, t) * backward(i, t + 1) *
-                  emission[i].Probability(dataSeq[seq].unsafe_col(t + 1)) /
-                  scales[t + 1];
-          }
-
-          // Add to list of emission observations, for Distribution::Estimate().
-          emissionList.col(sumTime) = dataSeq[seq].col(t);
-          emissionProb[j][sumTime] = stateProb(j, t);
+          arma::mat weightedBackward = backward.cols(1, length - 1) %
+              probs.cols(1, length - 1);
+          weightedBackward.each_row() /= trans(scales.subvec(1, length - 1));
+          threadTransition += weightedBackward *
+              trans(forward.cols(0, length - 2));
         }
-        sumTime++;
+      }
+
+      #pragma omp critical
+      {
+        newInitial += threadInitial;
+        newTransition += threadTransition;
+        loglik += threadLoglik;
       }
     }
 
     // Normalize the new initial probabilities.
-    if (dataSeq.size() == 0)
+    if (dataSeq.size() != 0)
       initial = newInitial / dataSeq.size();
 
     // Assign the new transition matrix.  We use %= (element-wise
@@ -188,7 +218,8 @@ void HMM<Distribution>::Train(const std::vector<arma::mat>& dataSeq)
 
     // Now estimate emission probabilities.
     for (size_t state = 0; state < transition.n_cols; state++)
-      emission[state].Estimate(emissionList, emissionProb[state]);
+      emission[state].Estimate(emissionList,
+          trans(emissionProb.row(state)));
 
     Log::Debug << "Iteration " << iter << ": log-likelihood " << loglik
         << std::endl;
@@ -300,9 +331,13 @@ double HMM<Distribution>::Estimate(const arma::mat& dataSeq,
                                    arma::mat& backwardProb,
                                    arma::vec& scales) const
 {
-  // First run the forward-backward algorithm.
-  Forward(dataSeq, scales, forwardProb);
-  Backward(dataSeq, scales, backwardProb);
+  // First compute the emission probabilities, which are used by both passes.
+  arma::mat emissionProb;
+  EmissionProbability(dataSeq, emissionProb);
+
+  // Now run the forward-backward algorithm.
+  Forward(emissionProb, scales, forwardProb);
+  Backward(emissionProb, scales, backwardProb);
 
   // Now assemble the state probability matrix based on the forward and backward
   // probabilities.
@@ -384,47 +419,113 @@ void HMM<Distribution>::Generate(const size_t length,
 template<typename Distribution>
 double HMM<Distribution>::Predict(const arma::mat& dataSeq,
                                   arma::Col<size_t>& stateSeq) const
+{
+  // Store the logs of the transposed transition matrix.  This is because we
+  // will be using the rows of the transition matrix.
+  arma::mat logTrans(log(trans(transition)));
+
+  arma::mat logEmissionProb;
+  arma::mat logStateProb;
+  arma::Mat<size_t> stateSeqBack;
+
+  return Viterbi(dataSeq, logTrans, stateSeq, logEmissionProb, logStateProb,
+      stateSeqBack);
+}
+
+/**
+ * Compute the most probable hidden state sequence for each of the given
+ * observation sequences using the Viterbi algorithm.
+ */
+template<typename Distribution>
+void HMM<Distribution>::Predict(const std::vector<arma::mat>& dataSeq,
+                                std::vector<arma::Col<size_t> >& stateSeq,
+                                arma::vec& logLikelihood) const
+{
+  stateSeq.resize(dataSeq.size());
+  logLikelihood.set_size(dataSeq.size());
+
+  // The log transition matrix is shared by all sequences.
+  const arma::mat logTrans(log(trans(transition)));
+
+  // Each thread keeps its own work buffers, which are reused for every
+  // sequence that thread decodes.
+  #pragma omp parallel
+  {
+    arma::mat logEmissionProb;
+    arma::mat logStateProb;
+    arma::Mat<size_t> stateSeqBack;
+
+    #pragma omp for schedule(dynamic)
+    for (size_t seq = 0; seq < dataSeq.size(); seq++)
+    {
+      logLikelihood[seq] = Viterbi(dataSeq[seq], logTrans, stateSeq[seq],
+          logEmissionProb, logStateProb, stateSeqBack);
+    }
+  }
+}
+
+/**
+ * Run the Viterbi algorithm on one observation sequence with the given work
+ * buffers.
+ */
+template<typename Distribution>
+double HMM<Distribution>::Viterbi(const arma::mat& dataSeq,
+                                  const arma::mat& logTrans,
+                                  arma::Col<size_t>& stateSeq,
+                                  arma::mat& logEmissionProb,
+                                  arma::mat& logStateProb,
+                                  arma::Mat<size_t>& stateSeqBack) const
 {
   // This is an implementation of the Viterbi algorithm for finding the most
   // probable sequence of states to produce the observed data sequence.  We
-  // don't use log-likelihoods to save that little bit of time, but we'll
-  // calculate the log-likelihood at the end of it all.
+  // work entirely with log-probabilities, so that long sequences do not
+  // underflow.
+  const size_t states = transition.n_rows;
   stateSeq.set_size(dataSeq.n_cols);
-  arma::mat logStateProb(transition.n_rows, dataSeq.n_cols);
-  arma::mat stateSeqBack(transition.n_rows, dataSeq.n_cols);
+  logStateProb.set_size(states, dataSeq.n_cols);
+  stateSeqBack.set_size(states, dataSeq.n_cols);
 
-  // Store the logs of the transposed transition matrix.  This is because we
-  // will be using the rows of the transition matrix.
-  arma::mat logTrans(log(trans(transition)));
+  // The emission log-probabilities of the whole sequence are computed at once.
+  LogEmissionProbability(dataSeq, logEmissionProb);
 
   // The calculation of the first state is slightly different; the probability
   // of the first state being state j is the maximum probability that the state
   // came to be j from another state.
-  logStateProb.col(0).zeros();
-  for (size_t state = 0; state < transition.n_rows; state++)
+  for (size_t state = 0; state < states; state++)
   {
-    logStateProb(state, 0) = log(initial[state] *
-        emission[state].Probability(dataSeq.unsafe_col(0)));
+    logStateProb(state, 0) = log(initial[state]) +
+        logEmissionProb(state, 0);
     stateSeqBack(state, 0) = state;
   }
 
-  // Store the best first state.
-  arma::uword index;
   for (size_t t = 1; t < dataSeq.n_cols; t++)
   {
     // Assemble the state probability for this element.
     // Given that we are in state j, we use state with the highest probability
     // of being the previous state.
-    for (size_t j = 0; j < transition.n_rows; j++)
+    const double* previous = logStateProb.colptr(t - 1);
+    for (size_t j = 0; j < states; j++)
     {
-      arma::vec prob = logStateProb.col(t - 1) + logTrans.col(j);
-      logStateProb(j, t) = prob.max(index) +
-          log(emission[j].Probability(dataSeq.unsafe_col(t)));
-        stateSeqBack(j, t) = index;
+      const double* logTransCol = logTrans.colptr(j);
+      double best = previous[0] + logTransCol[0];
+      size_t index = 0;
+      for (size_t i = 1; i < states; i++)
+      {
+        const double prob = previous[i] + logTransCol[i];
+        if (prob > best)
+        {
+          best = prob;
+          index = i;
+        }
+      }
+
+      logStateProb(j, t) = best + logEmissionProb(j, t);
+      stateSeqBack(j, t) = index;
     }
   }
 
   // Backtrack to find the most probable state sequence.
+  arma::uword index;
   logStateProb.unsafe_col(dataSeq.n_cols - 1).max(index);
   stateSeq[dataSeq.n_cols - 1] = index;
   for (size_t t = 2; t <= dataSeq.n_cols; t++)
@@ -440,53 +541,78 @@ double HMM<Distribution>::Predict(const arma::mat& dataSeq,
 template<typename Distribution>
 double HMM<Distribution>::LogLikelihood(const arma::mat& dataSeq) const
 {
+  arma::mat emissionProb;
   arma::mat forward;
   arma::vec scales;
 
-  Forward(dataSeq, scales, forward);
+  EmissionProbability(dataSeq, emissionProb);
+  Forward(emissionProb, scales, forward);
 
   // The log-likelihood is the log of the scales for each time step.
   return accu(log(scales));
 }
 
+/**
+ * Compute the probability of each observation under each emission distribution.
+ */
+template<typename Distribution>
+void HMM<Distribution>::EmissionProbability(const arma::mat& dataSeq,
+                                            arma::mat& emissionProb) const
+{
+  LogEmissionProbability(dataSeq, emissionProb);
+  emissionProb = exp(emissionProb);
+}
+
+/**
+ * Compute the log-probability of each observation under each emission
+ * distribution.
+ */
+template<typename Distribution>
+void HMM<Distribution>::LogEmissionProbability(const arma::mat& dataSeq,
+                                               arma::mat& logEmissionProb) const
+{
+  // Each distribution evaluates the whole sequence in a single call.
+  logEmissionProb.set_size(transition.n_rows, dataSeq.n_cols);
+  arma::vec logProb;
+  for (size_t state = 0; state < transition.n_rows; state++)
+  {
+    emission[state].LogProbability(dataSeq, logProb);
+    logEmissionProb.row(state) = trans(logProb);
+  }
+}
+
 /**
  * The Forward procedure (part of the Forward-Backward algorithm).
  */
 template<typename Distribution>
-void HMM<Distribution>::Forward(const arma::mat& dataSeq,
+void HMM<Distribution>::Forward(const arma::mat& emissionProb,
                                 arma::vec& scales,
                                 arma::mat& forwardProb) const
 {
   // Our goal is to calculate the forward probabilities:
   //  P(X_k | o_{1:k}) for all possible states X_k, for each time point k.
-  forwardProb.zeros(transition.n_rows, dataSeq.n_cols);
-  scales.zeros(dataSeq.n_cols);
+  forwardProb.zeros(transition.n_rows, emissionProb.n_cols);
+  scales.zeros(emissionProb.n_cols);
 
   // The first entry in the forward algorithm uses the initial state
   // probabilities.  Note that MATLAB assumes that the starting state (at
   // t = -1) is state 0; this is not our assumption here.  To force that
   // behavior, you could append a single starting state to every single data
   // sequence and that should produce results in line with MATLAB.
-  for (size_t state = 0; state < transition.n_rows; state++)
-    forwardProb(state, 0) = initial(state) *
-        emission[state].Probability(dataSeq.unsafe_col(0));
+  forwardProb.col(0) = initial % emissionProb.col(0);
 
   // Then normalize the column.
   scales[0] = accu(forwardProb.col(0));
   forwardProb.col(0) /= scales[0];
 
   // Now compute the probabilities for each successive observation.
-  for (size_t t = 1; t < dataSeq.n_cols; t++)
+  for (size_t t = 1; t < emissionProb.n_cols; t++)
   {
-    for (size_t j = 0; j < transition.n_rows; j++)
-    {
-      // The forward probability of state j at time t is the sum over all states
-      // of the probability of the previous state transitioning to the current
-      // state and emitting the given observation.
-      forwardProb(j, t) = accu(forwardProb.col(t - 1) %
-          trans(transition.row(j))) *
-          emission[j].Probability(dataSeq.unsafe_col(t));
-    }
+    // The forward probability of state j at time t is the sum over all states
+    // of the probability of the previous state transitioning to the current
+    // state and emitting the given observation.
+    forwardProb.col(t) = (transition * forwardProb.col(t - 1)) %
+        emissionProb.col(t);
 
     // Normalize probability.
     scales[t] = accu(forwardProb.col(t));
@@ -495,33 +621,27 @@ void HMM<Distribution>::Forward(const arma::mat& dataSeq,
 }
 
 template<typename Distribution>
-void HMM<Distribution>::Backward(const arma::mat& dataSeq,
+void HMM<Distribution>::Backward(const arma::mat& emissionProb,
                                  const arma::vec& scales,
                                  arma::mat& backwardProb) const
 {
   // Our goal is to calculate the backward probabilities:
   //  P(X_k | o_{k + 1:T}) for all possible states X_k, for each time point k.
-  backwardProb.zeros(transition.n_rows, dataSeq.n_cols);
+  backwardProb.zeros(transition.n_rows, emissionProb.n_cols);
 
   // The last element probability is 1.
-  backwardProb.col(dataSeq.n_cols - 1).fill(1);
+  backwardProb.col(emissionProb.n_cols - 1).fill(1);
 
   // Now step backwards through all other observations.
-  for (size_t t = dataSeq.n_cols - 2; t + 1 > 0; t--)
+  for (size_t t = emissionProb.n_cols - 2; t + 1 > 0; t--)
   {
-    for (size_t j = 0; j < transition.n_rows; j++)
-    {
-      // The backward probability of state j at time t is the sum over all state
-      // of the probability of the next state having been a transition from the
-      // current state multiplied by the probability of each of those states
-      // emitting the given observation.
-      for (size_t state = 0; state < transition.n_rows; state++)
-        backwardProb(j, t) += transition(state, j) * backwardProb(state, t + 1)
-            * emission[state].Probability(dataSeq.unsafe_col(t + 1));
-
-      // Normalize by the weights from the forward algorithm.
-      backwardProb(j, t) /= scales[t + 1];
-    }
+    // The backward probability of state j at time t is the sum over all states
+    // of the probability of the next state having been a transition from the
+    // current state multiplied by the probability of each of those states
+    // emitting the given observation.  This is then normalized by the weights
+    // from the forward algorithm.
+    backwardProb.col(t) = trans(transition) * (backwardProb.col(t + 1) %
+        emissionProb.col(t + 1)) / scales[t + 1];
   }
 }
 
@@ -24,6 +24,7 @@
 #define __MLPACK_METHODS_KERNEL_PCA_NAIVE_METHOD_HPP
 
 #include <mlpack/core.hpp>
+#include <mlpack/core/kernels/kernel_matrix.hpp>
 
 namespace mlpack {
 namespace kpca {
@@ -50,28 +51,11 @@ class NaiveKernelRule
                                   const size_t /* unused */,
                                   KernelType kernel = KernelType())
   {
-    // Construct the kernel matrix.
+    // Construct the kernel matrix.  Since it is symmetric, only the upper
+    // triangular part is evaluated; this is done in parallel, and with a
+    // matrix multiplication for kernels that only need dot products.
     arma::mat kernelMatrix;
-    // Resize the kernel matrix to the right size.
-    kernelMatrix.set_size(data.n_cols, data.n_cols);
-
-    // Note that we only need to calculate the upper triangular part of the 
-    // kernel matrix, since it is symmetric. This helps minimize the number of
-    // kernel evaluations.
-    for (size_t i = 0; i < data.n_cols; ++i)
-    {
-      for (size_t j = i; j < data.n_cols; ++j)
-      {
-        // Evaluate the kernel on these two points.
-        kernelMatrix(i, j) = kernel.Evaluate(data.unsafe_col(i),
-                                             data.unsafe_col(j));
-      }
-    }
-
-    // Copy to the lower triangular part of the matrix.
-    for (size_t i = 1; i < data.n_cols; ++i)
-      for (size_t j = 0; j < i; ++j)
-        kernelMatrix(i, j) = kernelMatrix(j, i);
+    kernel::KernelMatrix(kernel, data, kernelMatrix);
 
     // For PCA the data has to be centered, even if the data is centered. But it
     // is not guaranteed that the data, when mapped to the kernel space, is also
@@ -0,0 +1,135 @@
+/**
+ * @file gram_accumulator.hpp
+ *
+ * A class which accumulates X^T X and X^T y over chunks of points, so that
+ * LARS can be run on datasets which do not fit in memory.
+ *
+ * This file is part of MLPACK 1.0.10.
+ *
+ * MLPACK is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * MLPACK is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details (LICENSE.txt).
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * MLPACK.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __MLPACK_METHODS_LARS_GRAM_ACCUMULATOR_HPP
+#define __MLPACK_METHODS_LARS_GRAM_ACCUMULATOR_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace regression {
+
+/**
+ * Accumulate the Gram matrix X^T X and the vector X^T y of a dataset in one
+ * pass over its points, which may be given in chunks of any size.  Only
+ * O(d^2) memory is used, no matter how many points there are, so this can be
+ * used to run LARS on very tall datasets that are read from disk a piece at a
+ * time:
+ *
+ * @code
+ * GramAccumulator accumulator(dimensionality);
+ * while (...)
+ * {
+ *   // Load the next chunk of points (as columns) and their responses.
+ *   accumulator.Add(chunk, chunkResponses);
+ * }
+ *
+ * LARS lars(true, accumulator.Gram(), lambda1, lambda2);
+ * lars.RegressGram(accumulator.XTy(), beta);
+ * @endcode
+ *
+ * Chunks may be dense (arma::mat) or sparse (arma::sp_mat).
+ */
+class GramAccumulator
+{
+ public:
+  /**
+   * Create an empty accumulator for data of the given dimensionality.
+   *
+   * @param dimensionality Number of dimensions of the points.
+   */
+  GramAccumulator(const size_t dimensionality) :
+      gram(arma::zeros<arma::mat>(dimensionality, dimensionality)),
+      xty(arma::zeros<arma::vec>(dimensionality)),
+      points(0)
+  { }
+
+  /**
+   * Add a chunk of points to the accumulated X^T X and X^T y.
+   *
+   * @param chunk Points to add (each column is a point).
+   * @param responses Responses of the points.
+   */
+  void Add(const arma::mat& chunk, const arma::vec& responses)
+  {
+    CheckChunk(chunk.n_rows, chunk.n_cols, responses.n_elem);
+
+    // The points are columns of the chunk, so this is the chunk's contribution
+    // to X^T X.
+    gram += chunk * trans(chunk);
+    xty += chunk * responses;
+    points += chunk.n_cols;
+  }
+
+  /**
+   * Add a chunk of sparse points to the accumulated X^T X and X^T y.
+   *
+   * @param chunk Points to add (each column is a point).
+   * @param responses Responses of the points.
+   */
+  void Add(const arma::sp_mat& chunk, const arma::vec& responses)
+  {
+    CheckChunk(chunk.n_rows, chunk.n_cols, responses.n_elem);
+
+    gram += arma::mat(chunk * trans(chunk));
+    xty += chunk * responses;
+    points += chunk.n_cols;
+  }
+
+  //! Get the accumulated Gram matrix X^T X.
+  const arma::mat& Gram() const { return gram; }
+  //! Get the accumulated vector X^T y.
+  const arma::vec& XTy() const { return xty; }
+  //! Get the number of points which have been added.
+  size_t Points() const { return points; }
+
+ private:
+  //! The accumulated Gram matrix.
+  arma::mat gram;
+  //! The accumulated X^T y.
+  arma::vec xty;
+  //! The number of points which have been added.
+  size_t points;
+
+  //! Make sure a chunk has the right size.
+  void CheckChunk(const size_t rows,
+                  const size_t cols,
+                  const size_t responses) const
+  {
+    if (rows != gram.n_rows)
+    {
+      Log::Fatal << "GramAccumulator::Add(): chunk has " << rows
+          << " dimensions, but " << gram.n_rows << " were expected!"
+          << std::endl;
+    }
+
+    if (responses != cols)
+    {
+      Log::Fatal << "GramAccumulator::Add(): chunk has " << cols
+          << " points, but " << responses << " responses!" << std::endl;
+    }
+  }
+};
+
+}; // namespace regression
+}; // namespace mlpack
+
+#endif
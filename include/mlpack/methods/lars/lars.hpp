@@ -36,6 +36,8 @@
 
 #include <mlpack/core.hpp>
 
+#include "gram_accumulator.hpp"
+
 namespace mlpack {
 namespace regression {
 
@@ -151,6 +153,45 @@ class LARS
                arma::vec& beta,
                const bool transposeData = true);
 
+  /**
+   * Run LARS on sparse data.  X^T X and X^T y are computed with sparse
+   * products (unless a Gram matrix was passed to the constructor), and then
+   * the regression only works with those (see RegressGram()), so the data is
+   * never densified or copied.
+   *
+   * @param data Column-major input data (or row-major input data if
+   *     transposeData = false).
+   * @param responses A vector of targets.
+   * @param beta Vector to store the solution (the coefficients) in.
+   * @param transposeData Set to false if the data is row-major.
+   */
+  void Regress(const arma::sp_mat& data,
+               const arma::vec& responses,
+               arma::vec& beta,
+               const bool transposeData = true);
+
+  /**
+   * Run LARS given only X^T y, using the Gram matrix X^T X that was passed to
+   * the constructor.  Every quantity LARS needs can be computed from these
+   * two, so the cost of each iteration depends only on the number of
+   * dimensions, not on the number of points.  This is the method to use for
+   * very tall data, where X^T X and X^T y can be accumulated in one pass over
+   * the points (see GramAccumulator) without ever holding X in memory.
+   *
+   * The Gram matrix should not include the l2-norm penalty; it is added
+   * internally if lambda2 > 0.
+   *
+   * The global Timer is not thread-safe, so callers that run many regressions
+   * at once (one LARS object per thread) should pass timed = false.
+   *
+   * @param vecXTy The vector X^T y.
+   * @param beta Vector to store the solution (the coefficients) in.
+   * @param timed If true, the regression is timed as "lars_regression".
+   */
+  void RegressGram(const arma::vec& vecXTy,
+                   arma::vec& beta,
+                   const bool timed = true);
+
   //! Access the set of active dimensions.
   const std::vector<size_t>& ActiveSet() const { return activeSet; }
 
@@ -257,4 +298,7 @@ class LARS
 }; // namespace regression
 }; // namespace mlpack
 
+// Include implementation.
+#include "lars_impl.hpp"
+
 #endif
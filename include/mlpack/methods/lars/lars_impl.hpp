@@ -0,0 +1,326 @@
+/**
+ * @file lars_impl.hpp
+ *
+ * Implementation of the LARS regression on sparse data and on a precomputed
+ * Gram matrix.
+ *
+ * This file is part of MLPACK 1.0.10.
+ *
+ * MLPACK is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * MLPACK is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details (LICENSE.txt).
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * MLPACK.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __MLPACK_METHODS_LARS_LARS_IMPL_HPP
+#define __MLPACK_METHODS_LARS_LARS_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "lars.hpp"
+
+namespace mlpack {
+namespace regression {
+
+inline void LARS::Regress(const arma::sp_mat& data,
+                          const arma::vec& responses,
+                          arma::vec& beta,
+                          const bool transposeData)
+{
+  // If transposeData is true, the points are the columns of the data, so
+  // X = data^T.
+  const size_t dims = (transposeData ? data.n_rows : data.n_cols);
+
+  arma::vec vecXTy;
+  if (transposeData)
+    vecXTy = data * responses;
+  else
+    vecXTy = trans(data) * responses;
+
+  // Compute the Gram matrix, unless one was given to the constructor.
+  if (matGram.n_elem != dims * dims)
+  {
+    // In this case, matGram references matGramInternal.
+    if (transposeData)
+      matGramInternal = arma::mat(data * trans(data));
+    else
+      matGramInternal = arma::mat(trans(data) * data);
+  }
+
+  RegressGram(vecXTy, beta);
+}
+
+inline void LARS::RegressGram(const arma::vec& vecXTy,
+                              arma::vec& beta,
+                              const bool timed)
+{
+  const size_t dims = vecXTy.n_elem;
+  if (matGram.n_rows != dims || matGram.n_cols != dims)
+  {
+    Log::Fatal << "LARS::RegressGram(): Gram matrix has size " << matGram.n_rows
+        << "x" << matGram.n_cols << ", but X^T y has " << dims << " elements!"
+        << std::endl;
+  }
+
+  if (timed)
+    Timer::Start("lars_regression");
+
+  // Set up active set variables.  In the beginning, the active set has size 0
+  // (all dimensions are inactive).
+  isActive.resize(dims, false);
+
+  // Set up ignores set variables.  Initialized empty.
+  isIgnored.resize(dims, false);
+
+  // Initialize beta.  Since the prediction is X beta, the correlations of the
+  // residual with each dimension are X^T y - X^T X beta, so no other state is
+  // needed.
+  beta.zeros(dims);
+
+  bool lassocond = false;
+
+  // Compute the initial maximum correlation among all dimensions.
+  arma::vec corr = vecXTy;
+  double maxCorr = 0;
+  size_t changeInd = 0;
+  for (size_t i = 0; i < dims; ++i)
+  {
+    if (fabs(corr(i)) > maxCorr)
+    {
+      maxCorr = fabs(corr(i));
+      changeInd = i;
+    }
+  }
+
+  betaPath.push_back(beta);
+  lambdaPath.push_back(maxCorr);
+
+  // If the maximum correlation is too small, there is no reason to continue.
+  if (maxCorr < lambda1)
+  {
+    lambdaPath[0] = lambda1;
+    if (timed)
+      Timer::Stop("lars_regression");
+    return;
+  }
+
+  // The correlations of each dimension with the direction of the prediction.
+  arma::vec dirCorr(dims);
+
+  // Main loop.
+  while ((activeSet.size() + ignoreSet.size() < dims) && (maxCorr > tolerance))
+  {
+    // Compute the maximum correlation among inactive dimensions.
+    maxCorr = 0;
+    for (size_t i = 0; i < dims; i++)
+    {
+      if ((!isActive[i]) && (!isIgnored[i]) && (fabs(corr(i)) > maxCorr))
+      {
+        maxCorr = fabs(corr(i));
+        changeInd = i;
+      }
+    }
+
+    if (!lassocond)
+    {
+      if (useCholesky)
+      {
+        arma::vec newGramCol(activeSet.size());
+        for (size_t i = 0; i < activeSet.size(); i++)
+          newGramCol[i] = matGram(activeSet[i], changeInd);
+
+        CholeskyInsert(matGram(changeInd, changeInd), newGramCol);
+      }
+
+      // Add variable to active set.
+      Activate(changeInd);
+    }
+
+    // Compute signs of correlations.
+    arma::vec s(activeSet.size());
+    for (size_t i = 0; i < activeSet.size(); i++)
+      s(i) = corr(activeSet[i]) / fabs(corr(activeSet[i]));
+
+    // Compute the "equiangular" direction in parameter space (betaDirection).
+    arma::vec unnormalizedBetaDirection;
+    double normalization;
+    arma::vec betaDirection;
+    if (useCholesky)
+    {
+      // Check for singularity.
+      const double lastUtriElement = matUtriCholFactor(
+          matUtriCholFactor.n_cols - 1, matUtriCholFactor.n_rows - 1);
+      if (std::abs(lastUtriElement) > tolerance)
+      {
+        // Ok, no singularity.  With S the signs, inv((R % S)^T (R % S)) 1 is
+        // s % solve(R, solve(R^T, s)).
+        unnormalizedBetaDirection = solve(trimatu(matUtriCholFactor),
+            solve(trimatl(trans(matUtriCholFactor)), s));
+
+        normalization = 1.0 / sqrt(dot(s, unnormalizedBetaDirection));
+        betaDirection = normalization * unnormalizedBetaDirection;
+      }
+      else
+      {
+        // Singularity, so remove variable from active set, add to ignores set,
+        // and look for new variable to add.
+        #pragma omp critical
+        Log::Warn << "Encountered singularity when adding variable "
+            << changeInd << "; ignoring variable from now on." << std::endl;
+
+        Deactivate(activeSet.size() - 1);
+        Ignore(changeInd);
+
+        CholeskyDelete(matUtriCholFactor.n_rows - 1);
+        continue;
+      }
+    }
+    else
+    {
+      arma::mat matGramActive(activeSet.size(), activeSet.size());
+      for (size_t i = 0; i < activeSet.size(); i++)
+        for (size_t j = 0; j < activeSet.size(); j++)
+          matGramActive(i, j) = matGram(activeSet[i], activeSet[j]) * s(i) *
+              s(j);
+
+      if (elasticNet)
+        matGramActive.diag() += lambda2;
+
+      // Check for singularity.
+      const bool solvedOk = solve(unnormalizedBetaDirection, matGramActive,
+          arma::ones<arma::vec>(activeSet.size()));
+      if (solvedOk)
+      {
+        // Ok, no singularity.
+        normalization = 1.0 / sqrt(sum(unnormalizedBetaDirection));
+        betaDirection = normalization * unnormalizedBetaDirection % s;
+      }
+      else
+      {
+        // Singularity, so remove variable from active set, add to ignores set,
+        // and look for new variable to add.
+        Deactivate(activeSet.size() - 1);
+        Ignore(changeInd);
+        #pragma omp critical
+        Log::Warn << "Encountered singularity when adding variable "
+            << changeInd << "; ignoring variable from now on." << std::endl;
+        continue;
+      }
+    }
+
+    double gamma = maxCorr / normalization;
+
+    // If not all variables are active.
+    if ((activeSet.size() + ignoreSet.size()) < dims)
+    {
+      // The correlations with the direction of the prediction, X^T X
+      // betaDirection, only involve the columns of the active dimensions.
+      dirCorr.zeros();
+      for (size_t i = 0; i < activeSet.size(); i++)
+        dirCorr += betaDirection(i) * matGram.col(activeSet[i]);
+
+      for (size_t ind = 0; ind < dims; ind++)
+      {
+        if (isActive[ind] || isIgnored[ind])
+          continue;
+
+        double val1 = (maxCorr - corr(ind)) / (normalization - dirCorr(ind));
+        double val2 = (maxCorr + corr(ind)) / (normalization + dirCorr(ind));
+        if ((val1 > 0) && (val1 < gamma))
+          gamma = val1;
+        if ((val2 > 0) && (val2 < gamma))
+          gamma = val2;
+      }
+    }
+
+    // Bound gamma according to LASSO.
+    if (lasso)
+    {
+      lassocond = false;
+      double lassoboundOnGamma = DBL_MAX;
+      size_t activeIndToKickOut = -1;
+
+      for (size_t i = 0; i < activeSet.size(); i++)
+      {
+        double val = -beta(activeSet[i]) / betaDirection(i);
+        if ((val > 0) && (val < lassoboundOnGamma))
+        {
+          lassoboundOnGamma = val;
+          activeIndToKickOut = i;
+        }
+      }
+
+      if (lassoboundOnGamma < gamma)
+      {
+        gamma = lassoboundOnGamma;
+        lassocond = true;
+        changeInd = activeIndToKickOut;
+      }
+    }
+
+    // Update the estimator.
+    for (size_t i = 0; i < activeSet.size(); i++)
+      beta(activeSet[i]) += gamma * betaDirection(i);
+
+    // Sanity check to make sure the kicked out dimension is actually zero.
+    if (lassocond)
+    {
+      if (beta(activeSet[changeInd]) != 0)
+        beta(activeSet[changeInd]) = 0;
+    }
+
+    betaPath.push_back(beta);
+
+    if (lassocond)
+    {
+      // Index is in position changeInd in activeSet.
+      if (useCholesky)
+        CholeskyDelete(changeInd);
+
+      Deactivate(changeInd);
+    }
+
+    // Only the active dimensions have nonzero coefficients, so X^T X beta only
+    // involves their columns of the Gram matrix.
+    corr = vecXTy;
+    for (size_t i = 0; i < activeSet.size(); i++)
+      corr -= beta(activeSet[i]) * matGram.col(activeSet[i]);
+    if (elasticNet)
+      corr -= lambda2 * beta;
+
+    double curLambda = 0;
+    for (size_t i = 0; i < activeSet.size(); i++)
+      curLambda += fabs(corr(activeSet[i]));
+
+    curLambda /= ((double) activeSet.size());
+
+    lambdaPath.push_back(curLambda);
+
+    // Time to stop for LASSO?
+    if (lasso)
+    {
+      if (curLambda <= lambda1)
+      {
+        InterpolateBeta();
+        break;
+      }
+    }
+  }
+
+  // Unfortunate copy...
+  beta = betaPath.back();
+
+  if (timed)
+    Timer::Stop("lars_regression");
+}
+
+}; // namespace regression
+}; // namespace mlpack
+
+#endif
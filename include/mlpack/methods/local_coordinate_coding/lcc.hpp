@@ -59,6 +59,10 @@ namespace lcc {
  * problems problems; this can be done efficiently using LARS, an algorithm
  * that can solve the LASSO (paper below).
  *
+ * The points are coded in parallel (if OpenMP is available), and since most of
+ * the codes are zero, Z is stored as a sparse matrix; the dictionary step only
+ * touches the nonzero codes.
+ *
  * The papers are listed below.
  *
  * @code
@@ -141,9 +145,9 @@ class LocalCoordinateCoding
   arma::mat& Dictionary() { return dictionary; }
 
   //! Accessor the codes.
-  const arma::mat& Codes() const { return codes; }
+  const arma::sp_mat& Codes() const { return codes; }
   //! Modify the codes.
-  arma::mat& Codes() { return codes; }
+  arma::sp_mat& Codes() { return codes; }
 
   // Returns a string representation of this object. 
   std::string ToString() const;
@@ -158,11 +162,20 @@ class LocalCoordinateCoding
   //! Dictionary (columns are atoms).
   arma::mat dictionary;
 
-  //! Codes (columns are points).
-  arma::mat codes;
+  //! Codes (columns are points).  Most codes are zero, so they are stored as a
+  //! sparse matrix.
+  arma::sp_mat codes;
 
   //! l1 regularization term.
   double lambda;
+
+  /**
+   * Compute the indices of the nonzero entries of the codes matrix (unrolled
+   * column by column).
+   *
+   * @param adjacencies Vector to store the indices in.
+   */
+  void Adjacencies(arma::uvec& adjacencies) const;
 };
 
 }; // namespace lcc
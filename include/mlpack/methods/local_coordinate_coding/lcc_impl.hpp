@@ -56,7 +56,8 @@ void LocalCoordinateCoding<DictionaryInitializer>::Encode(
   Log::Info << "Initial Coding Step." << std::endl;
 
   OptimizeCode();
-  arma::uvec adjacencies = find(codes);
+  arma::uvec adjacencies;
+  Adjacencies(adjacencies);
 
   Log::Info << "  Sparsity level: " << 100.0 * ((double)(adjacencies.n_elem)) /
       ((double)(atoms * data.n_cols)) << "%.\n";
@@ -78,7 +79,7 @@ void LocalCoordinateCoding<DictionaryInitializer>::Encode(
     // Second step: perform the coding.
     Log::Info << "Performing coding step..." << std::endl;
     OptimizeCode();
-    adjacencies = find(codes);
+    Adjacencies(adjacencies);
     Log::Info << "  Sparsity level: " << 100.0 * ((double) (adjacencies.n_elem))
         / ((double)(atoms * data.n_cols)) << "%.\n";
 
@@ -112,176 +113,181 @@ void LocalCoordinateCoding<DictionaryInitializer>::Encode(
 template<typename DictionaryInitializer>
 void LocalCoordinateCoding<DictionaryInitializer>::OptimizeCode()
 {
-  arma::mat invSqDists = 1.0 / (repmat(trans(sum(square(dictionary))), 1,
-      data.n_cols) + repmat(sum(square(data)), atoms, 1) - 2 * trans(dictionary)
-      * data);
+  const arma::mat dictGram = trans(dictionary) * dictionary;
+  const arma::vec dictNorms = diagvec(dictGram);
 
-  arma::mat dictGram = trans(dictionary) * dictionary;
-  arma::mat dictGramTD(dictGram.n_rows, dictGram.n_cols);
+  // The nonzero codes of each point, which are collected into the sparse codes
+  // matrix once every point has been coded.
+  std::vector<arma::uvec> pointAtoms(data.n_cols);
+  std::vector<arma::vec> pointCodes(data.n_cols);
 
-  for (size_t i = 0; i < data.n_cols; i++)
+  // The points are independent, so they can be coded in parallel.  Each thread
+  // reuses its own scratch space for the weighted Gram matrix.
+  #pragma omp parallel
   {
-    // report progress
-    if ((i % 100) == 0)
+    arma::vec invW(atoms);
+    arma::mat dictGramTD(atoms, atoms);
+    arma::vec beta;
+
+    #pragma omp for schedule(dynamic, 16)
+    for (size_t i = 0; i < data.n_cols; i++)
     {
-      Log::Debug << "Optimization at point " << i << "." << std::endl;
-    }
+      // report progress
+      if ((i % 100) == 0)
+      {
+        #pragma omp critical
+        Log::Debug << "Optimization at point " << i << "." << std::endl;
+      }
 
-    arma::vec invW = invSqDists.unsafe_col(i);
-    arma::mat dictPrime = dictionary * diagmat(invW);
+      // The inverse squared distances between the point and each atom.
+      const arma::vec dictTX = trans(dictionary) * data.col(i);
+      invW = 1.0 / (dictNorms + dot(data.col(i), data.col(i)) - 2 * dictTX);
 
-    arma::mat dictGramTD = diagmat(invW) * dictGram * diagmat(invW);
+      // The Gram matrix of the weighted dictionary, dictionary * diag(invW).
+      for (size_t j = 0; j < atoms; ++j)
+        for (size_t k = 0; k < atoms; ++k)
+          dictGramTD(k, j) = invW[k] * dictGram(k, j) * invW[j];
 
-    bool useCholesky = false;
-    regression::LARS lars(useCholesky, dictGramTD, 0.5 * lambda);
+      bool useCholesky = false;
+      regression::LARS lars(useCholesky, dictGramTD, 0.5 * lambda);
 
-    // Run LARS for this point, by making an alias of the point and passing
-    // that.
-    arma::vec beta = codes.unsafe_col(i);
-    lars.Regress(dictPrime, data.unsafe_col(i), beta, false);
-    beta %= invW; // Remember, beta is an alias of codes.col(i).
+      // Run LARS for this point against the weighted dictionary, whose
+      // X^T y is invW % (dictionary^T x).  The global Timer is not thread-safe,
+      // so the regression is not timed.
+      lars.RegressGram(invW % dictTX, beta, false);
+      beta %= invW;
+
+      pointAtoms[i] = find(beta);
+      pointCodes[i] = beta.elem(pointAtoms[i]);
+    }
   }
+
+  // Assemble the sparse codes matrix in compressed sparse column format.
+  arma::uvec colPtrs(data.n_cols + 1);
+  colPtrs[0] = 0;
+  for (size_t i = 0; i < data.n_cols; ++i)
+    colPtrs[i + 1] = colPtrs[i] + pointAtoms[i].n_elem;
+
+  arma::uvec rowIndices(colPtrs[data.n_cols]);
+  arma::vec values(colPtrs[data.n_cols]);
+  for (size_t i = 0; i < data.n_cols; ++i)
+  {
+    if (pointAtoms[i].n_elem == 0)
+      continue;
+
+    rowIndices.subvec(colPtrs[i], colPtrs[i + 1] - 1) = pointAtoms[i];
+    values.subvec(colPtrs[i], colPtrs[i + 1] - 1) = pointCodes[i];
+  }
+
+  codes = arma::sp_mat(rowIndices, colPtrs, values, atoms, data.n_cols);
 }
 
 template<typename DictionaryInitializer>
 void LocalCoordinateCoding<DictionaryInitializer>::OptimizeDictionary(
     arma::uvec adjacencies)
 {
-  // Count number of atomic neighbors for each point x^i.
-  arma::uvec neighborCounts = arma::zeros<arma::uvec>(data.n_cols, 1);
-  if (adjacencies.n_elem > 0)
+  // The adjacencies are sorted, so the nonzero codes of each point are
+  // contiguous; find where the nonzero codes of each point start.
+  arma::Col<size_t> pointStarts(data.n_cols + 1);
+  size_t l = 0;
+  for (size_t i = 0; i <= data.n_cols; ++i)
   {
-    // This gets the column index.  Intentional integer division.
-    size_t curPointInd = (size_t) (adjacencies(0) / atoms);
-    ++neighborCounts(curPointInd);
+    while (l < adjacencies.n_elem && (size_t) adjacencies(l) < i * atoms)
+      ++l;
+    pointStarts[i] = l;
+  }
+
+  // The dictionary minimizes a weighted least squares problem, which is the
+  // solution of the linear system A D^T = B with
+  //
+  //   A = Z Z^T + diag(lambda sum_i |Z_i^j|),
+  //   B^T = sum_{i, j : Z_i^j != 0} (Z_i^j + lambda |Z_i^j|) X_i e_j^T.
+  //
+  // These are accumulated from the nonzero codes only, in O(nnz(Z) d) time and
+  // O(k d) memory.  Each thread accumulates the terms of its own points, and we
+  // then sum the results.
+  arma::mat dataCodesT(data.n_rows, atoms);
+  dataCodesT.zeros();
+  arma::mat codesZT(atoms, atoms);
+  codesZT.zeros();
+
+  #pragma omp parallel
+  {
+    arma::mat threadDataCodesT(data.n_rows, atoms);
+    threadDataCodesT.zeros();
+    arma::mat threadCodesZT(atoms, atoms);
+    threadCodesZT.zeros();
 
-    size_t nextColIndex = (curPointInd + 1) * atoms;
-    for (size_t l = 1; l < adjacencies.n_elem; l++)
+    #pragma omp for schedule(static)
+    for (size_t i = 0; i < data.n_cols; ++i)
     {
-      // If l no longer refers to an element in this column, advance the column
-      // number accordingly.
-      if (adjacencies(l) >= nextColIndex)
+      for (size_t a = pointStarts[i]; a < pointStarts[i + 1]; ++a)
       {
-        curPointInd = (size_t) (adjacencies(l) / atoms);
-        nextColIndex = (curPointInd + 1) * atoms;
+        const size_t j = adjacencies(a) - i * atoms;
+        const double code = codes(j, i);
+        threadDataCodesT.col(j) += (code + lambda * std::abs(code)) *
+            data.col(i);
+        threadCodesZT(j, j) += lambda * std::abs(code);
+
+        // Only the lower triangle of Z Z^T is accumulated.
+        for (size_t b = pointStarts[i]; b <= a; ++b)
+        {
+          const size_t k = adjacencies(b) - i * atoms;
+          threadCodesZT(j, k) += code * codes(k, i);
+        }
       }
-
-      ++neighborCounts(curPointInd);
     }
-  }
-
-  // Build dataPrime := [X x^1 ... x^1 ... x^n ... x^n]
-  // where each x^i is repeated for the number of neighbors x^i has.
-  arma::mat dataPrime = arma::zeros(data.n_rows,
-      data.n_cols + adjacencies.n_elem);
 
-  dataPrime(arma::span::all, arma::span(0, data.n_cols - 1)) = data;
-
-  size_t curCol = data.n_cols;
-  for (size_t i = 0; i < data.n_cols; i++)
-  {
-    if (neighborCounts(i) > 0)
+    #pragma omp critical
     {
-      dataPrime(arma::span::all, arma::span(curCol, curCol + neighborCounts(i)
-          - 1)) = repmat(data.col(i), 1, neighborCounts(i));
+      dataCodesT += threadDataCodesT;
+      codesZT += threadCodesZT;
     }
-    curCol += neighborCounts(i);
   }
 
+  codesZT = symmatl(codesZT);
+
   // Handle the case of inactive atoms (atoms not used in the given coding).
+  // An atom is inactive exactly when its diagonal entry of A is zero.
   std::vector<size_t> inactiveAtoms;
+  std::vector<size_t> activeAtoms;
   for (size_t j = 0; j < atoms; ++j)
-    if (accu(codes.row(j) != 0) == 0)
+  {
+    if (codesZT(j, j) == 0)
       inactiveAtoms.push_back(j);
+    else
+      activeAtoms.push_back(j);
+  }
 
   const size_t nInactiveAtoms = inactiveAtoms.size();
   const size_t nActiveAtoms = atoms - nInactiveAtoms;
 
-  // Efficient construction of codes restricted to active atoms.
-  arma::mat codesPrime = arma::zeros(nActiveAtoms, data.n_cols +
-      adjacencies.n_elem);
-  arma::vec wSquared = arma::ones(data.n_cols + adjacencies.n_elem, 1);
-
-  if (nInactiveAtoms > 0)
-  {
-    Log::Warn << "There are " << nInactiveAtoms
-        << " inactive atoms.  They will be re-initialized randomly.\n";
-
-    // Create matrix holding only active codes.
-    arma::mat activeCodes;
-    math::RemoveRows(codes, inactiveAtoms, activeCodes);
-
-    // Create reverse atom lookup for active atoms.
-    arma::uvec atomReverseLookup(atoms);
-    size_t inactiveOffset = 0;
-    for (size_t i = 0; i < atoms; ++i)
-    {
-      if (inactiveAtoms[inactiveOffset] == i)
-        ++inactiveOffset;
-      else
-        atomReverseLookup(i - inactiveOffset) = i;
-    }
-
-    codesPrime(arma::span::all, arma::span(0, data.n_cols - 1)) = activeCodes;
-
-    // Fill the rest of codesPrime.
-    for (size_t l = 0; l < adjacencies.n_elem; ++l)
-    {
-      // Recover the location in the codes matrix that this adjacency refers to.
-      size_t atomInd = adjacencies(l) % atoms;
-      size_t pointInd = (size_t) (adjacencies(l) / atoms);
-
-      // Fill matrix.
-      codesPrime(atomReverseLookup(atomInd), data.n_cols + l) = 1.0;
-      wSquared(data.n_cols + l) = codes(atomInd, pointInd);
-    }
-  }
-  else
-  {
-    // All atoms are active.
-    codesPrime(arma::span::all, arma::span(0, data.n_cols - 1)) = codes;
-
-    for (size_t l = 0; l < adjacencies.n_elem; ++l)
-    {
-      // Recover the location in the codes matrix that this adjacency refers to.
-      size_t atomInd = adjacencies(l) % atoms;
-      size_t pointInd = (size_t) (adjacencies(l) / atoms);
-
-      // Fill matrix.
-      codesPrime(atomInd, data.n_cols + l) = 1.0;
-      wSquared(data.n_cols + l) = codes(atomInd, pointInd);
-    }
-  }
-
-  wSquared.subvec(data.n_cols, wSquared.n_elem - 1) = lambda *
-      abs(wSquared.subvec(data.n_cols, wSquared.n_elem - 1));
-
   // Solve system.
   if (nInactiveAtoms == 0)
   {
     // No inactive atoms.  We can solve directly.
-    arma::mat A = codesPrime * diagmat(wSquared) * trans(codesPrime);
-    arma::mat B = codesPrime * diagmat(wSquared) * trans(dataPrime);
-
-    dictionary = trans(solve(A, B));
-    /*
-    dictionary = trans(solve(codesPrime * diagmat(wSquared) * trans(codesPrime),
-        codesPrime * diagmat(wSquared) * trans(dataPrime)));
-    */
+    dictionary = trans(solve(codesZT, trans(dataCodesT)));
   }
   else
   {
+    Log::Warn << "There are " << nInactiveAtoms
+        << " inactive atoms.  They will be re-initialized randomly.\n";
+
     // Inactive atoms must be reinitialized randomly, so we cannot solve
     // directly for the entire dictionary estimate.
-    arma::mat dictionaryActive =
-      trans(solve(codesPrime * diagmat(wSquared) * trans(codesPrime),
-                  codesPrime * diagmat(wSquared) * trans(dataPrime)));
+    arma::uvec activeIndices(nActiveAtoms);
+    for (size_t j = 0; j < nActiveAtoms; ++j)
+      activeIndices[j] = activeAtoms[j];
+
+    arma::mat dictionaryActive = trans(solve(codesZT.submat(activeIndices,
+        activeIndices), trans(dataCodesT.cols(activeIndices))));
 
     // Update all atoms.
     size_t currentInactiveIndex = 0;
     for (size_t i = 0; i < atoms; ++i)
     {
-      if (inactiveAtoms[currentInactiveIndex] == i)
+      if (currentInactiveIndex < nInactiveAtoms &&
+          inactiveAtoms[currentInactiveIndex] == i)
       {
         // This atom is inactive.  Reinitialize it randomly.
         dictionary.col(i) = (data.col(math::RandInt(data.n_cols)) +
@@ -309,6 +315,7 @@ double LocalCoordinateCoding<DictionaryInitializer>::Objective(
 {
   double weightedL1NormZ = 0;
 
+  #pragma omp parallel for reduction(+:weightedL1NormZ) schedule(static)
   for (size_t l = 0; l < adjacencies.n_elem; l++)
   {
     // Map adjacency back to its location in the codes matrix.
@@ -319,9 +326,33 @@ double LocalCoordinateCoding<DictionaryInitializer>::Objective(
         arma::sum(arma::square(dictionary.col(atomInd) - data.col(pointInd))));
   }
 
-  double froNormResidual = norm(data - dictionary * codes, "fro");
-  return std::pow(froNormResidual, 2.0) + lambda * weightedL1NormZ;
+  // The residual of each point only involves the atoms with nonzero codes.
+  double froNormResidualSq = 0;
+
+  #pragma omp parallel for reduction(+:froNormResidualSq) schedule(static)
+  for (size_t i = 0; i < data.n_cols; i++)
+  {
+    arma::vec residual = data.col(i);
+    for (size_t l = codes.col_ptrs[i]; l < codes.col_ptrs[i + 1]; ++l)
+      residual -= codes.values[l] * dictionary.col(codes.row_indices[l]);
+
+    froNormResidualSq += dot(residual, residual);
+  }
+
+  return froNormResidualSq + lambda * weightedL1NormZ;
+}
+
+template<typename DictionaryInitializer>
+void LocalCoordinateCoding<DictionaryInitializer>::Adjacencies(
+    arma::uvec& adjacencies) const
+{
+  // The nonzero codes are stored column by column, so the indices are sorted.
+  adjacencies.set_size(codes.n_nonzero);
+  for (size_t i = 0; i < data.n_cols; i++)
+    for (size_t l = codes.col_ptrs[i]; l < codes.col_ptrs[i + 1]; ++l)
+      adjacencies[l] = i * atoms + codes.row_indices[l];
 }
+
 template<typename DictionaryInitializer>
 std::string LocalCoordinateCoding<DictionaryInitializer>::ToString() const
 {
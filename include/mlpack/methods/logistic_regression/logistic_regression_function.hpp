@@ -113,6 +113,114 @@ class LogisticRegressionFunction
                 const size_t i,
                 arma::mat& gradient) const;
 
+  /**
+   * Evaluate the logistic regression log-likelihood function with the given
+   * parameters, using only the points begin, ..., begin + batchSize - 1.  This
+   * is the sum of Evaluate(parameters, i) over those points, but it is computed
+   * with a single matrix-vector product, so it is useful for mini-batch
+   * optimizers such as SGD.
+   *
+   * @param parameters Vector of logistic regression parameters.
+   * @param begin Index of first point to use for objective function evaluation.
+   * @param batchSize Number of points to use for objective function evaluation.
+   */
+  double Evaluate(const arma::mat& parameters,
+                  const size_t begin,
+                  const size_t batchSize) const
+  {
+    const arma::vec weights = parameters.col(0).subvec(1,
+        parameters.n_elem - 1);
+
+    // Each point contributes the same regularization term.
+    const double regularization = batchSize * lambda *
+        (1.0 / (2.0 * predictors.n_cols)) * arma::dot(weights, weights);
+
+    const arma::vec sigmoids = 1.0 / (1.0 + arma::exp(-parameters(0, 0) -
+        trans(predictors.cols(begin, begin + batchSize - 1)) * weights));
+
+    // The log-likelihood of each point is log(sigmoid) if the response is 1 and
+    // log(1 - sigmoid) if the response is 0.  Only the term for the response
+    // is evaluated, as in Evaluate(parameters, i); weighting both terms by the
+    // response would give 0 * -inf = NaN once a sigmoid saturates.
+    double logLikelihood = 0;
+    for (size_t j = 0; j < batchSize; ++j)
+      logLikelihood += (responses[begin + j] == 1) ? log(sigmoids[j]) :
+          log(1.0 - sigmoids[j]);
+
+    return -logLikelihood + regularization;
+  }
+
+  /**
+   * Evaluate the gradient of the logistic regression log-likelihood function
+   * with the given parameters, with respect to only the points begin, ...,
+   * begin + batchSize - 1.  This is the sum of Gradient(parameters, i,
+   * gradient) over those points, computed with matrix-vector products.
+   *
+   * @param parameters Vector of logistic regression parameters.
+   * @param begin Index of first point to use for gradient evaluation.
+   * @param batchSize Number of points to use for gradient evaluation.
+   * @param gradient Vector to output gradient into.
+   */
+  void Gradient(const arma::mat& parameters,
+                const size_t begin,
+                const size_t batchSize,
+                arma::mat& gradient) const
+  {
+    const arma::vec weights = parameters.col(0).subvec(1,
+        parameters.n_elem - 1);
+
+    // Each point contributes the same regularization term.
+    const arma::vec regularization = batchSize * lambda * weights /
+        predictors.n_cols;
+
+    const arma::vec errors = responses.subvec(begin, begin + batchSize - 1) -
+        1.0 / (1.0 + arma::exp(-parameters(0, 0) -
+        trans(predictors.cols(begin, begin + batchSize - 1)) * weights));
+
+    gradient.set_size(parameters.n_elem, 1);
+    gradient[0] = -accu(errors);
+    gradient.rows(1, parameters.n_elem - 1) =
+        -predictors.cols(begin, begin + batchSize - 1) * errors +
+        regularization;
+  }
+
+  /**
+   * Take a gradient step with respect to only one point in the dataset,
+   * directly on the given parameters; that is, perform
+   * parameters -= stepSize * gradient, where the gradient is what
+   * Gradient(parameters, i, gradient) would compute.  No gradient vector is
+   * built, and if lambda is 0, only the parameters corresponding to nonzero
+   * dimensions of the point are written.  This is used by ParallelSGD, where
+   * many threads update the same parameters at once.
+   *
+   * @param parameters Vector of logistic regression parameters (will be
+   *     modified).
+   * @param i Index of point to use for the gradient step.
+   * @param stepSize Step size of the gradient step.
+   */
+  void UpdateIterate(arma::mat& parameters,
+                     const size_t i,
+                     const double stepSize) const
+  {
+    const double* point = predictors.colptr(i);
+    const size_t dimensionality = predictors.n_rows;
+
+    double activation = parameters[0];
+    for (size_t k = 0; k < dimensionality; ++k)
+      activation += point[k] * parameters[k + 1];
+
+    const double step = stepSize * (responses[i] - 1.0 /
+        (1.0 + std::exp(-activation)));
+    const double decay = stepSize * lambda / predictors.n_cols;
+
+    parameters[0] += step;
+    for (size_t k = 0; k < dimensionality; ++k)
+    {
+      if (point[k] != 0.0 || decay != 0.0)
+        parameters[k + 1] += step * point[k] - decay * parameters[k + 1];
+    }
+  }
+
   //! Return the initial point for the optimization.
   const arma::mat& GetInitialPoint() const { return initialPoint; }
 
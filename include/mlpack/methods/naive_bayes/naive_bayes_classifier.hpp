@@ -67,6 +67,9 @@ class NaiveBayesClassifier
   //! Class probabilities.
   arma::vec probabilities;
 
+  //! Number of training points seen for each class.
+  arma::vec counts;
+
  public:
   /**
    * Initializes the classifier as per the input and then trains it by
@@ -84,18 +87,44 @@ class NaiveBayesClassifier
    * @param data Training data points.
    * @param labels Labels corresponding to training data points.
    * @param classes Number of classes in this classifier.
-   * @param incrementalVariance If true, an incremental algorithm is used to
-   *     calculate the variance; this can prevent loss of precision in some
-   *     cases, but will be somewhat slower to calculate.
+   * @param incrementalVariance Ignored; the means and variances are always
+   *     calculated with the numerically stable incremental algorithm (see
+   *     Train()).
    */
   NaiveBayesClassifier(const MatType& data,
                        const arma::Col<size_t>& labels,
                        const size_t classes,
                        const bool incrementalVariance = false);
 
+  /**
+   * Initialize an untrained classifier, with no points seen for any class, to
+   * be trained with Train() (possibly on many batches of data).
+   *
+   * @param dimensionality Number of features of the data.
+   * @param classes Number of classes in this classifier.
+   */
+  NaiveBayesClassifier(const size_t dimensionality, const size_t classes);
+
+  /**
+   * Train the classifier on a batch of data, on top of the data it has already
+   * been trained on; the means, variances and class probabilities are exactly
+   * those of all of the data seen so far.  The points are split among the
+   * threads, which each accumulate the count, mean and sum of squared
+   * differences of each class with Welford's algorithm; these are then merged
+   * (in order) with the pairwise formula of Chan, Golub and LeVeque, as is the
+   * batch with the existing model.
+   *
+   * @param data Training data points.
+   * @param labels Labels corresponding to training data points.
+   */
+  void Train(const MatType& data, const arma::Col<size_t>& labels);
+
   /**
    * Given a bunch of data points, this function evaluates the class of each of
-   * those data points, and puts it in the vector 'results'.
+   * those data points, and puts it in the vector 'results'.  The joint
+   * log-likelihood of each point and each class is computed in log space (so
+   * it does not underflow for many features), with matrix operations on blocks
+   * of points that are processed in parallel.
    *
    * @code
    * arma::mat test_data; // each column is a test point
@@ -123,6 +152,9 @@ class NaiveBayesClassifier
   const arma::vec& Probabilities() const { return probabilities; }
   //! Modify the prior probabilities for each class.
   arma::vec& Probabilities() { return probabilities; }
+
+  //! Get the number of training points seen for each class.
+  const arma::vec& Counts() const { return counts; }
 };
 
 }; // namespace naive_bayes
@@ -39,72 +39,119 @@ NaiveBayesClassifier<MatType>::NaiveBayesClassifier(
     const MatType& data,
     const arma::Col<size_t>& labels,
     const size_t classes,
-    const bool incrementalVariance)
+    const bool /* incrementalVariance */)
 {
-  const size_t dimensionality = data.n_rows;
-
   // Update the variables according to the number of features and classes
   // present in the data.
   probabilities.zeros(classes);
+  counts.zeros(classes);
+  means.zeros(data.n_rows, classes);
+  variances.zeros(data.n_rows, classes);
+
+  Train(data, labels);
+}
+
+template<typename MatType>
+NaiveBayesClassifier<MatType>::NaiveBayesClassifier(
+    const size_t dimensionality,
+    const size_t classes)
+{
+  probabilities.zeros(classes);
+  counts.zeros(classes);
   means.zeros(dimensionality, classes);
   variances.zeros(dimensionality, classes);
+}
+
+template<typename MatType>
+void NaiveBayesClassifier<MatType>::Train(const MatType& data,
+                                          const arma::Col<size_t>& labels)
+{
+  const size_t dimensionality = means.n_rows;
+  const size_t classes = means.n_cols;
+
+  if (data.n_rows != dimensionality)
+    Log::Fatal << "NaiveBayesClassifier::Train(): data has " << data.n_rows
+        << " dimensions, but the classifier has " << dimensionality << "."
+        << std::endl;
+  if (labels.n_elem != data.n_cols)
+    Log::Fatal << "NaiveBayesClassifier::Train(): " << labels.n_elem
+        << " labels given for " << data.n_cols << " points." << std::endl;
+  if (labels.n_elem > 0 && arma::max(labels) >= classes)
+    Log::Fatal << "NaiveBayesClassifier::Train(): label " << arma::max(labels)
+        << " is not less than the number of classes (" << classes << ")."
+        << std::endl;
 
   Log::Info << "Training Naive Bayes classifier on " << data.n_cols
       << " examples with " << dimensionality << " features each." << std::endl;
 
-  // Calculate the class probabilities as well as the sample mean and variance
-  // for each of the features with respect to each of the labels.
-  if (incrementalVariance)
-  {
-    // Use incremental algorithm.
-    for (size_t j = 0; j < data.n_cols; ++j)
-    {
-      const size_t label = labels[j];
-      ++probabilities[label];
-
-      arma::vec delta = data.col(j) - means.col(label);
-      means.col(label) += delta / probabilities[label];
-      variances.col(label) += delta % (data.col(j) - means.col(label));
-    }
+  // Each thread accumulates the statistics of a contiguous range of points
+  // with Welford's algorithm.
+  const size_t threads = std::max(std::min((size_t) omp_get_max_threads(),
+      (size_t) data.n_cols), (size_t) 1);
+  std::vector<arma::vec> threadCounts(threads);
+  std::vector<arma::mat> threadMeans(threads);
+  std::vector<arma::mat> threadSquares(threads);
 
-    for (size_t i = 0; i < classes; ++i)
-    {
-      if (probabilities[i] > 2)
-        variances.col(i) /= (probabilities[i] - 1);
-    }
-  }
-  else
+  #pragma omp parallel for schedule(static, 1)
+  for (size_t t = 0; t < threads; ++t)
   {
-    // Don't use incremental algorithm.  This is a two-pass algorithm.  It is
-    // possible to calculate the means and variances using a faster one-pass
-    // algorithm but there are some precision and stability issues.  If this is
-    // too slow, it's an option to use the faster algorithm by default and then
-    // have this (and the incremental algorithm) be other options.
-
-    // Calculate the means.
-    for (size_t j = 0; j < data.n_cols; ++j)
+    arma::vec& n = threadCounts[t];
+    arma::mat& mean = threadMeans[t];
+    arma::mat& squares = threadSquares[t];
+    n.zeros(classes);
+    mean.zeros(dimensionality, classes);
+    squares.zeros(dimensionality, classes);
+
+    const size_t begin = (t * data.n_cols) / threads;
+    const size_t end = ((t + 1) * data.n_cols) / threads;
+    for (size_t j = begin; j < end; ++j)
     {
       const size_t label = labels[j];
-      ++probabilities[label];
-      means.col(label) += data.col(j);
+      const double count = ++n[label];
+      double* meanCol = mean.colptr(label);
+      double* squaresCol = squares.colptr(label);
+      for (size_t k = 0; k < dimensionality; ++k)
+      {
+        const double x = data(k, j);
+        const double delta = x - meanCol[k];
+        meanCol[k] += delta / count;
+        squaresCol[k] += delta * (x - meanCol[k]);
+      }
     }
+  }
 
-    // Normalize means.
-    for (size_t i = 0; i < classes; ++i)
-      if (probabilities[i] != 0.0)
-        means.col(i) /= probabilities[i];
+  // The existing model is the first set of statistics to merge with.
+  arma::mat totalSquares(dimensionality, classes);
+  for (size_t i = 0; i < classes; ++i)
+    totalSquares.col(i) = (counts[i] > 1) ?
+        arma::vec(variances.col(i) * (counts[i] - 1)) :
+        arma::vec(arma::zeros<arma::vec>(dimensionality));
 
-    // Calculate variances.
-    for (size_t j = 0; j < data.n_cols; ++j)
+  // Merge the statistics of the threads, in order.
+  for (size_t t = 0; t < threads; ++t)
+  {
+    for (size_t i = 0; i < classes; ++i)
     {
-      const size_t label = labels[j];
-      variances.col(label) += square(data.col(j) - means.col(label));
+      const double n = threadCounts[t][i];
+      if (n == 0)
+        continue;
+
+      const double total = counts[i] + n;
+      const arma::vec delta = threadMeans[t].col(i) - means.col(i);
+      totalSquares.col(i) += threadSquares[t].col(i) +
+          arma::square(delta) * (counts[i] * n / total);
+      means.col(i) += delta * (n / total);
+      counts[i] = total;
     }
+  }
 
-    // Normalize variances.
-    for (size_t i = 0; i < classes; ++i)
-      if (probabilities[i] > 1)
-        variances.col(i) /= (probabilities[i] - 1);
+  // Normalize the variances.
+  for (size_t i = 0; i < classes; ++i)
+  {
+    if (counts[i] > 1)
+      variances.col(i) = totalSquares.col(i) / (counts[i] - 1);
+    else
+      variances.col(i).zeros();
   }
 
   // Ensure that the variances are invertible.
@@ -112,7 +159,9 @@ NaiveBayesClassifier<MatType>::NaiveBayesClassifier(
     if (variances[i] == 0.0)
       variances[i] = 1e-50;
 
-  probabilities /= data.n_cols;
+  const double points = arma::accu(counts);
+  if (points > 0)
+    probabilities = counts / points;
 }
 
 template<typename MatType>
@@ -123,46 +172,47 @@ void NaiveBayesClassifier<MatType>::Classify(const MatType& data,
   // training data.
   Log::Assert(data.n_rows == means.n_rows);
 
-  arma::vec probs = arma::log(probabilities);
-  arma::mat invVar = 1.0 / variances;
-
-  arma::mat testProbs = arma::repmat(probs.t(), data.n_cols, 1);
-
   results.set_size(data.n_cols); // No need to fill with anything yet.
 
   Log::Info << "Running Naive Bayes classifier on " << data.n_cols
       << " data points with " << data.n_rows << " features each." << std::endl;
 
-  // Calculate the joint probability for each of the data points for each of the
-  // means.n_cols.
+  // The log of the prior times the normalization constant of each class's
+  // diagonal Gaussian.
+  const arma::mat invVar = 1.0 / variances;
+  const arma::vec logNormalizations = arma::log(probabilities) -
+      0.5 * data.n_rows * log(2 * M_PI) -
+      0.5 * trans(arma::sum(arma::log(variances), 0));
 
-  // Loop over every class.
-  for (size_t i = 0; i < means.n_cols; i++)
-  {
-    // This is an adaptation of gmm::phi() for the case where the covariance is
-    // a diagonal matrix.
-    arma::mat diffs = data - arma::repmat(means.col(i), 1, data.n_cols);
-    arma::mat rhs = -0.5 * arma::diagmat(invVar.col(i)) * diffs;
-    arma::vec exponents(diffs.n_cols);
-    for (size_t j = 0; j < diffs.n_cols; ++j)
-      exponents(j) = std::exp(arma::accu(diffs.col(j) % rhs.unsafe_col(j)));
-
-    testProbs.col(i) += log(pow(2 * M_PI, (double) data.n_rows / -2.0) *
-        pow(det(arma::diagmat(invVar.col(i))), -0.5) * exponents);
-  }
+  // Compute the joint log-likelihood of each point and each class, a block of
+  // points at a time, and take the class with the largest one.
+  const size_t blockSize = 1024;
+  const size_t blocks = (data.n_cols + blockSize - 1) / blockSize;
 
-  // Now calculate the label.
-  for (size_t i = 0; i < data.n_cols; ++i)
+  #pragma omp parallel for schedule(static)
+  for (size_t b = 0; b < blocks; ++b)
   {
-    // Find the index of the class with maximum probability for this point.
-    arma::uword maxIndex = 0;
-    arma::vec pointProbs = testProbs.row(i).t();
-    pointProbs.max(maxIndex);
+    const size_t begin = b * blockSize;
+    const size_t end = std::min(begin + blockSize, (size_t) data.n_cols);
+    const arma::mat block = data.cols(begin, end - 1);
 
-    results[i] = maxIndex;
-  }
+    arma::mat logLikelihoods(means.n_cols, block.n_cols);
+    for (size_t i = 0; i < means.n_cols; ++i)
+    {
+      arma::mat diffs = block;
+      diffs.each_col() -= means.col(i);
+      logLikelihoods.row(i) = logNormalizations[i] -
+          0.5 * trans(invVar.col(i)) * arma::square(diffs);
+    }
 
-  return;
+    // Find the index of the class with maximum probability for each point.
+    for (size_t j = 0; j < block.n_cols; ++j)
+    {
+      arma::uword maxIndex = 0;
+      logLikelihoods.col(j).max(maxIndex);
+      results[begin + j] = maxIndex;
+    }
+  }
 }
 
 }; // namespace naive_bayes
@@ -71,10 +71,14 @@ class NCA
    * @param tolerance Tolerance for termination of stochastic gradient descent.
    * @param shuffle Whether or not to shuffle the dataset during SGD.
    * @param metric Instantiated metric to use.
+   * @param neighbors If nonzero, the softmax sums of the full objective are
+   *     truncated to this many nearest neighbors of each point (see
+   *     SoftmaxErrorFunction).
    */
   NCA(const arma::mat& dataset,
       const arma::Col<size_t>& labels,
-      MetricType metric = MetricType());
+      MetricType metric = MetricType(),
+      const size_t neighbors = 0);
 
   /**
    * Perform Neighborhood Components Analysis.  The output distance learning
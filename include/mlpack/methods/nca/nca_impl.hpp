@@ -32,11 +32,12 @@ namespace nca {
 template<typename MetricType, template<typename> class OptimizerType>
 NCA<MetricType, OptimizerType>::NCA(const arma::mat& dataset,
                                     const arma::Col<size_t>& labels,
-                                    MetricType metric) :
+                                    MetricType metric,
+                                    const size_t neighbors) :
     dataset(dataset),
     labels(labels),
     metric(metric),
-    errorFunction(dataset, labels, metric),
+    errorFunction(dataset, labels, metric, neighbors),
     optimizer(OptimizerType<SoftmaxErrorFunction<MetricType> >(errorFunction))
 { /* Nothing to do. */ }
 
@@ -24,6 +24,7 @@
 #define __MLPACK_METHODS_NCA_NCA_SOFTMAX_ERROR_FUNCTION_HPP
 
 #include <mlpack/core.hpp>
+#include <mlpack/methods/neighbor_search/neighbor_search.hpp>
 
 namespace mlpack {
 namespace nca {
@@ -46,7 +47,26 @@ namespace nca {
  * In addition to the standard Evaluate() and Gradient() functions which MLPACK
  * optimizers use, overloads of Evaluate() and Gradient() are given which only
  * operate on one point in the dataset.  This is useful for optimizers like
- * stochastic gradient descent (see mlpack::optimization::SGD).
+ * stochastic gradient descent (see mlpack::optimization::SGD).  Both forms also
+ * have an EvaluateWithGradient(), which the optimizers use to compute the
+ * objective and gradient together, and there is a batch EvaluateWithGradient()
+ * for mini-batch SGD.
+ *
+ * The non-separable functions never store the n x n matrix of p_ij; instead,
+ * the points are split into blocks of rows, and the kernel values between each
+ * block and all of the points are computed (with a single matrix
+ * multiplication when the metric is the squared Euclidean distance), in
+ * parallel if OpenMP is available.  The gradient is then assembled with matrix
+ * multiplications in O(n^2 d) time instead of from n^2 outer products.
+ *
+ * Optionally, the sums over all points k in p_ij can be truncated to the given
+ * number of nearest neighbors of each point (in the stretched space), which are
+ * found with a kd-tree (for the Euclidean and squared Euclidean distances) or
+ * by brute force (for any other metric).  Since p_ij decays exponentially with
+ * distance, this is usually a very good approximation, and with the default
+ * metric it makes the non-separable functions scale to much larger datasets.
+ * The truncation is recomputed whenever the coordinates change, and does not
+ * apply to the separable functions.
  */
 template<typename MetricType = metric::SquaredEuclideanDistance>
 class SoftmaxErrorFunction
@@ -61,10 +81,13 @@ class SoftmaxErrorFunction
    * @param dataset Matrix containing the dataset.
    * @param labels Vector of class labels for each point in the dataset.
    * @param kernel Instantiated kernel (optional).
+   * @param neighbors Number of nearest neighbors to truncate the sums in the
+   *     non-separable functions to (0 means no truncation).
    */
   SoftmaxErrorFunction(const arma::mat& dataset,
                        const arma::Col<size_t>& labels,
-                       MetricType metric = MetricType());
+                       MetricType metric = MetricType(),
+                       const size_t neighbors = 0);
 
   /**
    * Evaluate the softmax function for the given covariance matrix.  This is the
@@ -112,6 +135,50 @@ class SoftmaxErrorFunction
                 const size_t i,
                 arma::mat& gradient);
 
+  /**
+   * Evaluate the softmax function and its gradient for the given covariance
+   * matrix.  This is the non-separable implementation; it is equivalent to
+   * calling Evaluate() and then Gradient(), but it is a little faster.
+   *
+   * @param covariance Covariance matrix of Mahalanobis distance.
+   * @param gradient Matrix to store the calculated gradient in.
+   */
+  double EvaluateWithGradient(const arma::mat& covariance,
+                              arma::mat& gradient);
+
+  /**
+   * Evaluate the softmax function and its gradient for the given covariance
+   * matrix on only one point of the dataset.  This is the separable
+   * implementation; it costs the same as one call to Gradient(), which already
+   * has to compute the objective of the point, so it is about twice as fast as
+   * calling Evaluate() and then Gradient().
+   *
+   * @param covariance Covariance matrix of Mahalanobis distance.
+   * @param i Index of point to use for objective function.
+   * @param gradient Matrix to store the calculated gradient in.
+   */
+  double EvaluateWithGradient(const arma::mat& covariance,
+                              const size_t i,
+                              arma::mat& gradient);
+
+  /**
+   * Evaluate the sum of the softmax function and its gradient for the given
+   * covariance matrix on the points begin, ..., begin + batchSize - 1.  The
+   * dataset only needs to be stretched once for the whole batch, so this is
+   * much faster than calling the separable EvaluateWithGradient() for each
+   * point.  This does not modify the object, so it is safe to call from
+   * several threads at once (as mini-batch SGD does).
+   *
+   * @param covariance Covariance matrix of Mahalanobis distance.
+   * @param begin Index of first point to use for objective function.
+   * @param batchSize Number of points to use for objective function.
+   * @param gradient Matrix to store the calculated gradient in.
+   */
+  double EvaluateWithGradient(const arma::mat& covariance,
+                              const size_t begin,
+                              const size_t batchSize,
+                              arma::mat& gradient) const;
+
   /**
    * Get the initial point.
    */
@@ -123,6 +190,10 @@ class SoftmaxErrorFunction
    */
   size_t NumFunctions() const { return dataset.n_cols; }
 
+  //! Get the number of nearest neighbors the sums are truncated to (0 means no
+  //! truncation).
+  size_t Neighbors() const { return neighbors; }
+
   // convert the obkect into a string
   std::string ToString() const;
 
@@ -135,19 +206,34 @@ class SoftmaxErrorFunction
   //! The instantiated metric.
   MetricType metric;
 
+  //! Number of nearest neighbors to truncate the sums to (0 for none).
+  size_t neighbors;
+
   //! Last coordinates.  Used for the non-separable Evaluate() and Gradient().
   arma::mat lastCoordinates;
   //! Stretched dataset.  Kept internal to avoid memory reallocations.
   arma::mat stretchedDataset;
+  //! Squared norms of the points in the stretched dataset, for the
+  //! non-separable Evaluate() and Gradient().
+  arma::vec stretchedNorms;
   //! Holds calculated p_i, for the non-separable Evaluate() and Gradient().
   arma::vec p;
   //! Holds denominators for calculation of p_ij, for the non-separable
   //! Evaluate() and Gradient().
   arma::vec denominators;
+  //! The nearest neighbors of each point, if the sums are truncated.
+  arma::Mat<size_t> neighborIndices;
+  //! The kernel values between each point and its nearest neighbors, if the
+  //! sums are truncated.
+  arma::mat neighborKernels;
 
   //! False if nothing has ever been precalculated (only at construction time).
   bool precalculated;
 
+  //! The maximum number of kernel values held by each thread at a time in the
+  //! non-separable functions.
+  static const size_t blockElements = 4194304;
+
   /**
    * Precalculate the denominators and numerators that will make up the p_ij,
    * but only if the coordinates matrix is different than the last coordinates
@@ -156,12 +242,64 @@ class SoftmaxErrorFunction
    *
    * This will update last_coordinates_ and stretched_dataset_, and also
    * calculate the p_i and denominators_ which are used in the calculation of
-   * p_i or p_ij.  The calculation will be O((n * (n + 1)) / 2), which is not
-   * great.
+   * p_i or p_ij.  The calculation takes O(n^2 d) time, unless the sums are
+   * truncated to the nearest neighbors.
    *
    * @param coordinates Coordinates matrix to use for precalculation.
    */
   void Precalculate(const arma::mat& coordinates);
+
+  /**
+   * Find the nearest neighbors of each point in the stretched dataset, and
+   * store them in neighborIndices and their distances in the given matrix.
+   * The kd-tree search is only exact for the Euclidean distance, so the
+   * squared Euclidean distance is searched with the Euclidean distance, and
+   * any other metric is searched by brute force.
+   */
+  void SearchNeighbors(const metric::SquaredEuclideanDistance& metric,
+                       arma::mat& distances);
+  //! Find the nearest neighbors with the Euclidean distance.
+  void SearchNeighbors(const metric::EuclideanDistance& metric,
+                       arma::mat& distances);
+  //! Find the nearest neighbors with any other metric, by brute force.
+  template<typename OtherMetricType>
+  void SearchNeighbors(const OtherMetricType& metric, arma::mat& distances);
+
+  /**
+   * Compute the kernel values exp(-d(A x_i, A x_k)) between the points
+   * begin, ..., end - 1 (rows) and all points (columns) of the stretched
+   * dataset.  The kernel value of each point with itself is set to 0.
+   *
+   * @param begin First point of the block.
+   * @param end One past the last point of the block.
+   * @param kernels Matrix to store the kernel values in.
+   */
+  void KernelBlock(const size_t begin,
+                   const size_t end,
+                   arma::mat& kernels) const;
+
+  /**
+   * Compute p_i and the weights w_k = p_ik (p_i - [k in class of i]) of the
+   * gradient of p_i for one point, from the given stretched dataset.  The
+   * gradient of -p_i is then -2 A sum_k w_k x_ik x_ik^T.
+   *
+   * @param stretched Stretched dataset (A * dataset).
+   * @param i Index of point.
+   * @param weights Vector to store the weights in (may be NULL).
+   * @return p_i.
+   */
+  double PointProbability(const arma::mat& stretched,
+                          const size_t i,
+                          arma::vec* weights) const;
+
+  /**
+   * Compute the gradient of -p_i for the given coordinates and the weights
+   * given by PointProbability(), and add it to the given gradient.
+   */
+  void AddPointGradient(const arma::mat& coordinates,
+                        const size_t i,
+                        const arma::vec& weights,
+                        arma::mat& gradient) const;
 };
 
 }; // namespace nca
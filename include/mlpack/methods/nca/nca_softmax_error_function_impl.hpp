@@ -33,10 +33,12 @@ template<typename MetricType>
 SoftmaxErrorFunction<MetricType>::SoftmaxErrorFunction(
     const arma::mat& dataset,
     const arma::Col<size_t>& labels,
-    MetricType metric) :
+    MetricType metric,
+    const size_t neighbors) :
     dataset(dataset),
     labels(labels),
     metric(metric),
+    neighbors(neighbors),
     precalculated(false)
 { /* nothing to do */ }
 
@@ -58,39 +60,11 @@ double SoftmaxErrorFunction<MetricType>::Evaluate(const arma::mat& coordinates,
 {
   // Unfortunately each evaluation will take O(N) time because it requires a
   // scan over all points in the dataset.  Our objective is to compute p_i.
-  double denominator = 0;
-  double numerator = 0;
-
-  // It's quicker to do this now than one point at a time later.
   stretchedDataset = coordinates * dataset;
 
-  for (size_t k = 0; k < dataset.n_cols; ++k)
-  {
-    // Don't consider the case where the points are the same.
-    if (k == i)
-      continue;
-
-    // We want to evaluate exp(-D(A x_i, A x_k)).
-    double eval = std::exp(-metric.Evaluate(stretchedDataset.unsafe_col(i),
-                                            stretchedDataset.unsafe_col(k)));
-
-    // If they are in the same
-    if (labels[i] == labels[k])
-      numerator += eval;
-
-    denominator += eval;
-  }
-
-  // Now the result is just a simple division, but we have to be sure that the
-  // denominator is not 0.
-  if (denominator == 0.0)
-  {
-    Log::Warn << "Denominator of p_" << i << " is 0!" << std::endl;
-    return 0;
-  }
-
-  return -(numerator / denominator); // Negate because the optimizer is a
-                                     // minimizer.
+  return -PointProbability(stretchedDataset, i, NULL); // Negate because the
+                                                       // optimizer is a
+                                                       // minimizer.
 }
 
 //! The non-separable implementation, where Precalculate() is used.
@@ -102,41 +76,109 @@ void SoftmaxErrorFunction<MetricType>::Gradient(const arma::mat& coordinates,
   Precalculate(coordinates);
 
   // Now, we handle the summation over i:
-  //   sum_i (p_i sum_k (p_ik x_ik x_ik^T) -
-  //       sum_{j in class of i} (p_ij x_ij x_ij^T)
-  // We can algebraically manipulate the whole thing to produce a more
-  // memory-friendly way to calculate this.  Looping over each i and k (again
-  // O((n * (n + 1)) / 2) as with the last step, we can add the following to the
-  // sum:
-  //
-  //   if class of i is the same as the class of k, add
-  //     (((p_i - (1 / p_i)) p_ik) + ((p_k - (1 / p_k)) p_ki)) x_ik x_ik^T
-  //   otherwise, add
-  //     (p_i p_ik + p_k p_ki) x_ik x_ik^T
-  arma::mat sum;
-  sum.zeros(stretchedDataset.n_rows, stretchedDataset.n_rows);
-  for (size_t i = 0; i < stretchedDataset.n_cols; i++)
+  //   sum_i sum_k (p_i - [k in class of i]) p_ik x_ik x_ik^T.
+  // Writing a_ik = (p_i - [k in class of i]) p_ik, and r and c for the row and
+  // column sums of the matrix a, this is
+  //   X diag(r) X^T + X diag(c) X^T - X a X^T - (X a X^T)^T
+  // which only takes O(n^2 d) time, and a never needs to be held in memory all
+  // at once.  Each thread accumulates its own terms.
+  const size_t n = dataset.n_cols;
+  arma::mat rowTerm, crossTerm;
+  rowTerm.zeros(dataset.n_rows, dataset.n_rows);
+  crossTerm.zeros(dataset.n_rows, dataset.n_rows);
+  arma::vec columnSums;
+  columnSums.zeros(n);
+
+  if (neighbors == 0)
   {
-    for (size_t k = (i + 1); k < stretchedDataset.n_cols; k++)
+    const size_t blockSize = std::max((size_t) 1,
+        std::min(n, (size_t) blockElements / std::max(n, (size_t) 1)));
+    const size_t numBlocks = (n + blockSize - 1) / blockSize;
+
+    #pragma omp parallel
+    {
+      arma::mat threadRowTerm, threadCrossTerm;
+      threadRowTerm.zeros(dataset.n_rows, dataset.n_rows);
+      threadCrossTerm.zeros(dataset.n_rows, dataset.n_rows);
+      arma::vec threadColumnSums;
+      threadColumnSums.zeros(n);
+      arma::mat a;
+
+      #pragma omp for schedule(dynamic)
+      for (size_t block = 0; block < numBlocks; ++block)
+      {
+        const size_t begin = block * blockSize;
+        const size_t end = std::min(begin + blockSize, n);
+
+        // Turn the kernel values of the block into a_ik.
+        KernelBlock(begin, end, a);
+        for (size_t k = 0; k < n; ++k)
+        {
+          for (size_t i = begin; i < end; ++i)
+          {
+            const double p_ik = a(i - begin, k) / denominators[i];
+            a(i - begin, k) = (labels[i] == labels[k]) ? (p[i] - 1) * p_ik :
+                p[i] * p_ik;
+          }
+        }
+
+        const arma::mat blockPoints = dataset.cols(begin, end - 1);
+        threadRowTerm += blockPoints * arma::diagmat(arma::sum(a, 1)) *
+            trans(blockPoints);
+        threadCrossTerm += blockPoints * (a * trans(dataset));
+        threadColumnSums += trans(arma::sum(a, 0));
+      }
+
+      #pragma omp critical
+      {
+        rowTerm += threadRowTerm;
+        crossTerm += threadCrossTerm;
+        columnSums += threadColumnSums;
+      }
+    }
+  }
+  else
+  {
+    // Only the nearest neighbors of each point contribute.  The weighted sum of
+    // the neighbors of each point gives one column of (a X^T)^T.
+    const size_t k = neighborIndices.n_rows;
+    arma::mat weightedNeighbors(dataset.n_rows, n);
+    arma::vec rowSums(n);
+
+    #pragma omp parallel
     {
-      // Calculate p_ik and p_ki first.
-      double eval = exp(-metric.Evaluate(stretchedDataset.unsafe_col(i),
-                                         stretchedDataset.unsafe_col(k)));
-      double p_ik = 0, p_ki = 0;
-      p_ik = eval / denominators(i);
-      p_ki = eval / denominators(k);
-
-      // Subtract x_i from x_k.  We are not using stretched points here.
-      arma::vec x_ik = dataset.col(i) - dataset.col(k);
-      arma::mat secondTerm = (x_ik * trans(x_ik));
-
-      if (labels[i] == labels[k])
-        sum += ((p[i] - 1) * p_ik + (p[k] - 1) * p_ki) * secondTerm;
-      else
-        sum += (p[i] * p_ik + p[k] * p_ki) * secondTerm;
+      arma::vec threadColumnSums;
+      threadColumnSums.zeros(n);
+
+      #pragma omp for schedule(static)
+      for (size_t i = 0; i < n; ++i)
+      {
+        weightedNeighbors.col(i).zeros();
+        rowSums[i] = 0;
+        for (size_t j = 0; j < k; ++j)
+        {
+          const size_t neighbor = neighborIndices(j, i);
+          const double p_ik = neighborKernels(j, i) / denominators[i];
+          const double a_ik = (labels[i] == labels[neighbor]) ?
+              (p[i] - 1) * p_ik : p[i] * p_ik;
+
+          weightedNeighbors.col(i) += a_ik * dataset.col(neighbor);
+          rowSums[i] += a_ik;
+          threadColumnSums[neighbor] += a_ik;
+        }
+      }
+
+      #pragma omp critical
+      columnSums += threadColumnSums;
     }
+
+    rowTerm = dataset * arma::diagmat(rowSums) * trans(dataset);
+    crossTerm = dataset * trans(weightedNeighbors);
   }
 
+  const arma::mat sum = rowTerm + dataset * arma::diagmat(columnSums) *
+      trans(dataset) - crossTerm - trans(crossTerm);
+
   // Assemble the final gradient.
   gradient = -2 * coordinates * sum;
 }
@@ -147,68 +189,62 @@ void SoftmaxErrorFunction<MetricType>::Gradient(const arma::mat& coordinates,
                                                 const size_t i,
                                                 arma::mat& gradient)
 {
-  // We will need to calculate p_i before this evaluation is done, so these two
-  // variables will hold the information necessary for that.
-  double numerator = 0;
-  double denominator = 0;
+  // Computing the gradient requires p_i anyway.
+  EvaluateWithGradient(coordinates, i, gradient);
+}
 
-  // The gradient involves two matrix terms which are eventually combined into
-  // one.
-  arma::mat firstTerm;
-  arma::mat secondTerm;
+//! The non-separable implementation, where Precalculate() is used.
+template<typename MetricType>
+double SoftmaxErrorFunction<MetricType>::EvaluateWithGradient(
+    const arma::mat& coordinates,
+    arma::mat& gradient)
+{
+  // Gradient() calls Precalculate(), so p is up to date afterwards.
+  Gradient(coordinates, gradient);
 
-  firstTerm.zeros(coordinates.n_rows, coordinates.n_cols);
-  secondTerm.zeros(coordinates.n_rows, coordinates.n_cols);
+  return -accu(p);
+}
 
+//! The separable implementation.
+template<typename MetricType>
+double SoftmaxErrorFunction<MetricType>::EvaluateWithGradient(
+    const arma::mat& coordinates,
+    const size_t i,
+    arma::mat& gradient)
+{
   // Compute the stretched dataset.
   stretchedDataset = coordinates * dataset;
 
-  for (size_t k = 0; k < dataset.n_cols; ++k)
-  {
-    // Don't consider the case where the points are the same.
-    if (i == k)
-      continue;
-
-    // Calculate the numerator of p_ik.
-    double eval = exp(-metric.Evaluate(stretchedDataset.unsafe_col(i),
-                                       stretchedDataset.unsafe_col(k)));
-
-    // If the points are in the same class, we must add to the second term of
-    // the gradient as well as the numerator of p_i.  We will divide by the
-    // denominator of p_ik later.  For x_ik we are not using stretched points.
-    arma::vec x_ik = dataset.col(i) - dataset.col(k);
-    if (labels[i] == labels[k])
-    {
-      numerator += eval;
-      secondTerm += eval * x_ik * trans(x_ik);
-    }
+  arma::vec weights;
+  const double p = PointProbability(stretchedDataset, i, &weights);
 
-    // We always have to add to the denominator of p_i and the first term of the
-    // gradient computation.  We will divide by the denominator of p_ik later.
-    denominator += eval;
-    firstTerm += eval * x_ik * trans(x_ik);
-  }
+  gradient.zeros(coordinates.n_rows, coordinates.n_cols);
+  AddPointGradient(coordinates, i, weights, gradient);
 
-  // Calculate p_i.
-  double p = 0;
-  if (denominator == 0)
-  {
-    Log::Warn << "Denominator of p_" << i << " is 0!" << std::endl;
-    // If the denominator is zero, then all p_ik should be zero and there is
-    // no gradient contribution from this point.
-    gradient.zeros(coordinates.n_rows, coordinates.n_rows);
-    return;
-  }
-  else
+  return -p; // Negate because the optimizer is a minimizer.
+}
+
+//! The batch implementation.
+template<typename MetricType>
+double SoftmaxErrorFunction<MetricType>::EvaluateWithGradient(
+    const arma::mat& coordinates,
+    const size_t begin,
+    const size_t batchSize,
+    arma::mat& gradient) const
+{
+  // The stretched dataset is shared by every point in the batch.
+  const arma::mat stretched = coordinates * dataset;
+
+  double objective = 0;
+  arma::vec weights;
+  gradient.zeros(coordinates.n_rows, coordinates.n_cols);
+  for (size_t i = begin; i < begin + batchSize; ++i)
   {
-    p = numerator / denominator;
-    firstTerm /= denominator;
-    secondTerm /= denominator;
+    objective -= PointProbability(stretched, i, &weights);
+    AddPointGradient(coordinates, i, weights, gradient);
   }
 
-  // Now multiply the first term by p_i, and add the two together and multiply
-  // all by 2 * A.  We negate it though, because our optimizer is a minimizer.
-  gradient = -2 * coordinates * (p * firstTerm - secondTerm);
+  return objective;
 }
 
 template<typename MetricType>
@@ -232,32 +268,71 @@ void SoftmaxErrorFunction<MetricType>::Precalculate(
   // Coordinates are different; save the new ones, and stretch the dataset.
   lastCoordinates = coordinates;
   stretchedDataset = coordinates * dataset;
+  stretchedNorms = trans(arma::sum(arma::square(stretchedDataset), 0));
 
   // For each point i, we must evaluate the softmax function:
   //   p_ij = exp( -K(x_i, x_j) ) / ( sum_{k != i} ( exp( -K(x_i, x_k) )))
   //   p_i = sum_{j in class of i} p_ij
   // We will do this by keeping track of the denominators for each i as well as
-  // the numerators (the sum for all j in class of i).  This will be on the
-  // order of O((n * (n + 1)) / 2), which really isn't all that great.
-  p.zeros(stretchedDataset.n_cols);
-  denominators.zeros(stretchedDataset.n_cols);
-  for (size_t i = 0; i < stretchedDataset.n_cols; i++)
+  // the numerators (the sum for all j in class of i).
+  const size_t n = stretchedDataset.n_cols;
+  p.zeros(n);
+  denominators.zeros(n);
+  if (neighbors == 0)
   {
-    for (size_t j = (i + 1); j < stretchedDataset.n_cols; j++)
+    // Compute the kernel values a block of rows at a time, with each block
+    // handled by a different thread.  This is O(n^2 d), which really isn't all
+    // that great.
+    const size_t blockSize = std::max((size_t) 1,
+        std::min(n, (size_t) blockElements / std::max(n, (size_t) 1)));
+    const size_t numBlocks = (n + blockSize - 1) / blockSize;
+
+    #pragma omp parallel
     {
-      // Evaluate exp(-d(x_i, x_j)).
-      double eval = exp(-metric.Evaluate(stretchedDataset.unsafe_col(i),
-                                         stretchedDataset.unsafe_col(j)));
+      arma::mat kernels;
 
-      // Add this to the denominators of both p_i and p_j: K(i, j) = K(j, i).
-      denominators[i] += eval;
-      denominators[j] += eval;
-
-      // If i and j are the same class, add to numerator of both.
-      if (labels[i] == labels[j])
+      #pragma omp for schedule(dynamic)
+      for (size_t block = 0; block < numBlocks; ++block)
+      {
+        const size_t begin = block * blockSize;
+        const size_t end = std::min(begin + blockSize, n);
+
+        KernelBlock(begin, end, kernels);
+        for (size_t k = 0; k < n; ++k)
+        {
+          for (size_t i = begin; i < end; ++i)
+          {
+            // Add this to the denominator of p_i, and to the numerator if i and
+            // k are the same class.
+            denominators[i] += kernels(i - begin, k);
+            if (labels[i] == labels[k])
+              p[i] += kernels(i - begin, k);
+          }
+        }
+      }
+    }
+  }
+  else
+  {
+    // Find the nearest neighbors of each point in the stretched space with a
+    // tree; the sums will only run over these.
+    if (neighbors >= n)
+      Log::Fatal << "SoftmaxErrorFunction: number of neighbors (" << neighbors
+          << ") must be less than the number of points (" << n << ")."
+          << std::endl;
+
+    arma::mat distances;
+    SearchNeighbors(metric, distances);
+    neighborKernels = arma::exp(-distances);
+
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < n; ++i)
+    {
+      for (size_t j = 0; j < neighbors; ++j)
       {
-        p[i] += eval;
-        p[j] += eval;
+        denominators[i] += neighborKernels(j, i);
+        if (labels[i] == labels[neighborIndices(j, i)])
+          p[i] += neighborKernels(j, i);
       }
     }
   }
@@ -266,7 +341,7 @@ void SoftmaxErrorFunction<MetricType>::Precalculate(
   p /= denominators;
 
   // Clean up any bad values.
-  for (size_t i = 0; i < stretchedDataset.n_cols; i++)
+  for (size_t i = 0; i < n; i++)
   {
     if (denominators[i] == 0.0)
     {
@@ -282,6 +357,146 @@ void SoftmaxErrorFunction<MetricType>::Precalculate(
   precalculated = true;
 }
 
+template<typename MetricType>
+void SoftmaxErrorFunction<MetricType>::SearchNeighbors(
+    const metric::SquaredEuclideanDistance& /* metric */,
+    arma::mat& distances)
+{
+  // The bounds of the kd-tree are Euclidean, so the search must use the
+  // Euclidean distance; it has the same nearest neighbors.
+  neighbor::NeighborSearch<neighbor::NearestNeighborSort,
+      metric::EuclideanDistance> search(stretchedDataset);
+  search.Search(neighbors, neighborIndices, distances);
+  distances = arma::square(distances);
+}
+
+template<typename MetricType>
+void SoftmaxErrorFunction<MetricType>::SearchNeighbors(
+    const metric::EuclideanDistance& /* metric */,
+    arma::mat& distances)
+{
+  neighbor::NeighborSearch<neighbor::NearestNeighborSort,
+      metric::EuclideanDistance> search(stretchedDataset);
+  search.Search(neighbors, neighborIndices, distances);
+}
+
+template<typename MetricType>
+template<typename OtherMetricType>
+void SoftmaxErrorFunction<MetricType>::SearchNeighbors(
+    const OtherMetricType& metric,
+    arma::mat& distances)
+{
+  // The kd-tree can only prune correctly with the Euclidean distance, so any
+  // other metric is searched by brute force.
+  neighbor::NeighborSearch<neighbor::NearestNeighborSort, OtherMetricType>
+      search(stretchedDataset, true, false, metric);
+  search.Search(neighbors, neighborIndices, distances);
+}
+
+template<typename MetricType>
+void SoftmaxErrorFunction<MetricType>::KernelBlock(const size_t begin,
+                                                   const size_t end,
+                                                   arma::mat& kernels) const
+{
+  if (boost::is_same<MetricType, metric::SquaredEuclideanDistance>::value)
+  {
+    // ||a - b||^2 = ||a||^2 + ||b||^2 - 2 a^T b, so the whole block is one
+    // matrix multiplication.
+    kernels = -2 * trans(stretchedDataset.cols(begin, end - 1)) *
+        stretchedDataset;
+    kernels.each_col() += stretchedNorms.subvec(begin, end - 1);
+    kernels.each_row() += trans(stretchedNorms);
+
+    // Rounding can make the distances very slightly negative.
+    kernels = arma::exp(-arma::clamp(kernels, 0.0, DBL_MAX));
+  }
+  else
+  {
+    MetricType localMetric(metric);
+    kernels.set_size(end - begin, stretchedDataset.n_cols);
+    for (size_t k = 0; k < stretchedDataset.n_cols; ++k)
+      for (size_t i = begin; i < end; ++i)
+        kernels(i - begin, k) = std::exp(-localMetric.Evaluate(
+            stretchedDataset.unsafe_col(i), stretchedDataset.unsafe_col(k)));
+  }
+
+  // Don't consider the case where the points are the same.
+  for (size_t i = begin; i < end; ++i)
+    kernels(i - begin, i) = 0;
+}
+
+template<typename MetricType>
+double SoftmaxErrorFunction<MetricType>::PointProbability(
+    const arma::mat& stretched,
+    const size_t i,
+    arma::vec* weights) const
+{
+  MetricType localMetric(metric);
+
+  // We want to evaluate exp(-D(A x_i, A x_k)) for every k.
+  arma::vec kernels(stretched.n_cols);
+  for (size_t k = 0; k < stretched.n_cols; ++k)
+    kernels[k] = std::exp(-localMetric.Evaluate(stretched.unsafe_col(i),
+                                                stretched.unsafe_col(k)));
+
+  // Don't consider the case where the points are the same.
+  kernels[i] = 0;
+
+  double numerator = 0;
+  double denominator = 0;
+  for (size_t k = 0; k < stretched.n_cols; ++k)
+  {
+    // If they are in the same class, add to the numerator too.
+    if (labels[i] == labels[k])
+      numerator += kernels[k];
+
+    denominator += kernels[k];
+  }
+
+  // Now the result is just a simple division, but we have to be sure that the
+  // denominator is not 0.
+  if (denominator == 0.0)
+  {
+    Log::Warn << "Denominator of p_" << i << " is 0!" << std::endl;
+
+    // Then all p_ik are zero and there is no gradient contribution from this
+    // point.
+    if (weights != NULL)
+      weights->zeros(stretched.n_cols);
+    return 0;
+  }
+
+  const double p = numerator / denominator;
+  if (weights != NULL)
+  {
+    // w_k = p_ik (p_i - [k in class of i]).
+    weights->set_size(stretched.n_cols);
+    for (size_t k = 0; k < stretched.n_cols; ++k)
+      (*weights)[k] = (kernels[k] / denominator) *
+          ((labels[i] == labels[k]) ? p - 1 : p);
+  }
+
+  return p;
+}
+
+template<typename MetricType>
+void SoftmaxErrorFunction<MetricType>::AddPointGradient(
+    const arma::mat& coordinates,
+    const size_t i,
+    const arma::vec& weights,
+    arma::mat& gradient) const
+{
+  // sum_k w_k x_ik x_ik^T, where x_ik = x_i - x_k (not stretched).
+  arma::mat differences = dataset;
+  differences.each_col() -= dataset.col(i);
+  const arma::mat sum = differences * arma::diagmat(weights) *
+      trans(differences);
+
+  // Multiply by 2 * A.  We negate it though, because our optimizer is a
+  // minimizer.
+  gradient -= 2 * coordinates * sum;
+}
+
 template<typename MetricType>
 std::string SoftmaxErrorFunction<MetricType>::ToString() const{
   std::ostringstream convert;
@@ -290,6 +505,7 @@ std::string SoftmaxErrorFunction<MetricType>::ToString() const{
       << std::endl;
   convert << "  Labels: " << labels.n_elem << std::endl;
   //convert << "Metric: " << metric << std::endl;
+  convert << "  Neighbors: " << neighbors << std::endl;
   convert << "  Precalculated: " << precalculated << std::endl;
   return convert.str();
 }
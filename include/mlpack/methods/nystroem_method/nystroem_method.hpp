@@ -56,6 +56,20 @@ class NystroemMethod
    */
   void Apply(arma::mat& output);
 
+  /**
+   * Map new points into the space of the factorization computed by Apply(),
+   * so that the kernel between a new point x and a reference point is
+   * approximated by the dot product of their rows of the outputs.  Only the
+   * kernel between the points and the selected points is needed, so points may
+   * be given in chunks of any size, without recomputing the factorization.
+   * Apply() must be called first.
+   *
+   * @param points Points to transform (one point per column).
+   * @param output Matrix to store the transformed points in (one row per
+   *     point).
+   */
+  void Transform(const arma::mat& points, arma::mat& output) const;
+
   /**
    * Construct the kernel matrix with matrix that contains the selected points.
    *
@@ -78,6 +92,12 @@ class NystroemMethod
                        arma::mat& miniKernel, 
                        arma::mat& semiKernel);
 
+  //! Get the selected points (only valid after Apply()).
+  const arma::mat& Landmarks() const { return landmarks; }
+  //! Get the mapping from kernel values with the selected points to the
+  //! output space (only valid after Apply()).
+  const arma::mat& Mapping() const { return mapping; }
+
  private:
   //! The reference dataset.
   const arma::mat& data;
@@ -85,6 +105,11 @@ class NystroemMethod
   KernelType& kernel;
   //! Rank used for matrix approximation.
   const size_t rank;
+  //! The selected points.
+  arma::mat landmarks;
+  //! The mapping from the kernel values with the selected points to the output
+  //! space.
+  arma::mat mapping;
 };
 
 }; // namespace kernel
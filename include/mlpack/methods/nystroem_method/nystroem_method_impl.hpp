@@ -26,6 +26,8 @@
 // In case it hasn't been included yet.
 #include "nystroem_method.hpp"
 
+#include <mlpack/core/kernels/kernel_matrix.hpp>
+
 namespace mlpack {
 namespace kernel {
 
@@ -41,24 +43,20 @@ NystroemMethod<KernelType, PointSelectionPolicy>::NystroemMethod(
 
 template<typename KernelType, typename PointSelectionPolicy>
 void NystroemMethod<KernelType, PointSelectionPolicy>::GetKernelMatrix(
-    const arma::mat* selectedData, 
-    arma::mat& miniKernel, 
+    const arma::mat* selectedData,
+    arma::mat& miniKernel,
     arma::mat& semiKernel)
 {
-  // Assemble mini-kernel matrix.
-  for (size_t i = 0; i < rank; ++i)
-    for (size_t j = 0; j < rank; ++j)
-      miniKernel(i, j) = kernel.Evaluate(selectedData->col(i),
-                                         selectedData->col(j));
-
-  // Construct semi-kernel matrix with interactions between selected data and
-  // all points.
-  for (size_t i = 0; i < data.n_cols; ++i)
-    for (size_t j = 0; j < rank; ++j)
-      semiKernel(i, j) = kernel.Evaluate(data.col(i), 
-                                         selectedData->col(j));
+  // Keep the selected points, so that new points can be transformed later.
+  landmarks = *selectedData;
+
   // Clean the memory.
   delete selectedData;
+
+  // Assemble mini-kernel matrix, and construct semi-kernel matrix with
+  // interactions between selected data and all points.
+  KernelMatrix(kernel, landmarks, miniKernel);
+  KernelMatrix(kernel, data, landmarks, semiKernel);
 }
 
 template<typename KernelType, typename PointSelectionPolicy>
@@ -67,18 +65,15 @@ void NystroemMethod<KernelType, PointSelectionPolicy>::GetKernelMatrix(
     arma::mat& miniKernel,
     arma::mat& semiKernel)
 {
-  // Assemble mini-kernel matrix.
+  // Keep the selected points, so that new points can be transformed later.
+  landmarks.set_size(data.n_rows, rank);
   for (size_t i = 0; i < rank; ++i)
-    for (size_t j = 0; j < rank; ++j)
-      miniKernel(i, j) = kernel.Evaluate(data.col(selectedPoints(i)),
-                                         data.col(selectedPoints(j)));
-
-  // Construct semi-kernel matrix with interactions between selected points and
-  // all points.
-  for (size_t i = 0; i < data.n_cols; ++i)
-    for (size_t j = 0; j < rank; ++j)
-      semiKernel(i, j) = kernel.Evaluate(data.col(i),
-                                         data.col(selectedPoints(j)));
+    landmarks.col(i) = data.col(selectedPoints(i));
+
+  // Assemble mini-kernel matrix, and construct semi-kernel matrix with
+  // interactions between selected points and all points.
+  KernelMatrix(kernel, landmarks, miniKernel);
+  KernelMatrix(kernel, data, landmarks, semiKernel);
 }
 
 template<typename KernelType, typename PointSelectionPolicy>
@@ -96,8 +91,24 @@ void NystroemMethod<KernelType, PointSelectionPolicy>::Apply(arma::mat& output)
   arma::svd(U, s, V, miniKernel);
 
   // Construct the output matrix.
-  arma::mat normalization = arma::diagmat(1.0 / sqrt(s));
-  output = semiKernel * U * normalization * V;
+  mapping = U * arma::diagmat(1.0 / sqrt(s)) * V;
+  output = semiKernel * mapping;
+}
+
+template<typename KernelType, typename PointSelectionPolicy>
+void NystroemMethod<KernelType, PointSelectionPolicy>::Transform(
+    const arma::mat& points,
+    arma::mat& output) const
+{
+  if (mapping.n_elem == 0)
+  {
+    Log::Fatal << "NystroemMethod::Transform(): Apply() must be called before "
+        << "points can be transformed!" << std::endl;
+  }
+
+  arma::mat semiKernel;
+  KernelMatrix(kernel, points, landmarks, semiKernel);
+  output = semiKernel * mapping;
 }
 
 }; // namespace kernel
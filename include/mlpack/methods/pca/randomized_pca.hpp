@@ -0,0 +1,381 @@
+/**
+ * @file randomized_pca.hpp
+ *
+ * Randomized principal components analysis, which finds the leading principal
+ * components with a randomized range finder in a few passes over the data,
+ * without forming the centered data or the full covariance decomposition.
+ *
+ * This file is part of MLPACK 1.0.10.
+ *
+ * MLPACK is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * MLPACK is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details (LICENSE.txt).
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * MLPACK.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __MLPACK_METHODS_PCA_RANDOMIZED_PCA_HPP
+#define __MLPACK_METHODS_PCA_RANDOMIZED_PCA_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace pca {
+
+/**
+ * This class implements randomized principal components analysis, following
+ * Halko, Martinsson and Tropp ("Finding structure with randomness:
+ * probabilistic algorithms for constructing approximate matrix
+ * decompositions", SIAM Review, 2011).  To find the leading r principal
+ * components of a d x n dataset, a random d x (r + p) matrix is multiplied by
+ * the covariance matrix C a few times (power iterations, with
+ * re-orthogonalization), and the top eigenvectors of C restricted to the
+ * resulting subspace are used.
+ *
+ * Each multiplication by C is one pass over the data, computed as
+ * sum_b A_b (A_b^T Q) over blocks of columns A_b of the centered (and possibly
+ * scaled) data, in parallel; neither the centered data nor C are ever formed.
+ * This takes O(d n (r + p)) time per pass and O(d (r + p)) memory, instead of
+ * the O(d^2 n + d^3) time and O(d n) memory of PCA.
+ *
+ * The Apply() overloads mirror those of PCA, so this class can be used in its
+ * place:
+ *
+ * @code
+ * extern arma::mat data;
+ *
+ * RandomizedPCA p;
+ * const double varRetained = p.Apply(data, 20); // Keep 20 dimensions.
+ * @endcode
+ */
+class RandomizedPCA
+{
+ public:
+  /**
+   * Create the RandomizedPCA object.
+   *
+   * @param scaleData Whether or not to scale the data in each dimension by its
+   *     standard deviation.
+   * @param oversampling Number of extra dimensions in the random subspace.
+   * @param powerIterations Number of power iterations (more give more accurate
+   *     components when the spectrum decays slowly).
+   * @param blockSize Number of points in each block of a pass over the data.
+   */
+  RandomizedPCA(const bool scaleData = false,
+                const size_t oversampling = 10,
+                const size_t powerIterations = 2,
+                const size_t blockSize = 4096) :
+      scaleData(scaleData),
+      oversampling(oversampling),
+      powerIterations(powerIterations),
+      blockSize(std::max(blockSize, (size_t) 1))
+  { }
+
+  /**
+   * Find the leading principal components of the given dataset, and transform
+   * the data onto them.  It is safe to pass the same matrix reference for both
+   * data and transformedData.
+   *
+   * @param data Data matrix.
+   * @param transformedData Matrix to put results of PCA into (rank x n).
+   * @param eigval Vector to put the leading eigenvalues into.
+   * @param eigvec Matrix to put the leading eigenvectors (loadings) into.
+   * @param rank Number of principal components to find.
+   */
+  void Apply(const arma::mat& data,
+             arma::mat& transformedData,
+             arma::vec& eigval,
+             arma::mat& eigvec,
+             const size_t rank) const
+  {
+    arma::vec mean, scale;
+    Statistics(data, mean, scale);
+    Decompose(data, mean, scale, rank, eigval, eigvec);
+    Transform(data, mean, scale, eigvec, transformedData);
+  }
+
+  /**
+   * Use randomized PCA for dimensionality reduction on the given dataset.  This
+   * will save the newDimension largest principal components of the data and
+   * remove the rest.  The amount of variance of the data that is retained is
+   * returned.
+   *
+   * @param data Data matrix.
+   * @param newDimension New dimension of the data.
+   * @return Amount of the variance of the data retained (between 0 and 1).
+   */
+  double Apply(arma::mat& data, const size_t newDimension) const
+  {
+    if (newDimension == 0)
+      Log::Fatal << "RandomizedPCA::Apply(): newDimension (" << newDimension
+          << ") cannot be zero!" << std::endl;
+    if (newDimension > data.n_rows)
+      Log::Fatal << "RandomizedPCA::Apply(): newDimension (" << newDimension
+          << ") cannot be greater than the existing dimensionality of the "
+          << "data (" << data.n_rows << ")!" << std::endl;
+
+    arma::vec mean, scale, eigval;
+    arma::mat eigvec;
+    const double totalVariance = Statistics(data, mean, scale);
+    Decompose(data, mean, scale, newDimension, eigval, eigvec);
+    Transform(data, mean, scale, eigvec, data);
+
+    return (totalVariance == 0) ? 1.0 : sum(eigval) / totalVariance;
+  }
+
+  //! This overload is here to make sure int gets casted right to size_t.
+  inline double Apply(arma::mat& data, const int newDimension) const
+  {
+    return Apply(data, size_t(newDimension));
+  }
+
+  /**
+   * Use randomized PCA for dimensionality reduction on the given dataset.  This
+   * will save as many dimensions as necessary to retain at least the given
+   * amount of variance.  The total variance is known from the first pass over
+   * the data, so the number of components is doubled until enough variance is
+   * retained; only the leading components are ever computed.
+   *
+   * @param data Data matrix.
+   * @param varRetained Lower bound on amount of variance to retain; should be
+   *     between 0 and 1.
+   * @return Actual amount of variance retained (between 0 and 1).
+   */
+  double Apply(arma::mat& data, const double varRetained) const
+  {
+    if (varRetained < 0)
+      Log::Fatal << "RandomizedPCA::Apply(): varRetained (" << varRetained
+          << ") must be greater than or equal to 0." << std::endl;
+    if (varRetained > 1)
+      Log::Fatal << "RandomizedPCA::Apply(): varRetained (" << varRetained
+          << ") should be less than or equal to 1." << std::endl;
+
+    arma::vec mean, scale, eigval;
+    arma::mat eigvec;
+    const double totalVariance = Statistics(data, mean, scale);
+
+    size_t rank = std::min((size_t) 16, (size_t) data.n_rows);
+    while (true)
+    {
+      Decompose(data, mean, scale, rank, eigval, eigvec);
+
+      // Find how many of the components are needed.
+      double retained = 0;
+      size_t newDimension = 0;
+      while (newDimension < eigval.n_elem && (totalVariance == 0 ||
+          retained / totalVariance < varRetained))
+        retained += eigval[newDimension++];
+
+      if ((totalVariance == 0 || retained / totalVariance >= varRetained) ||
+          rank == data.n_rows)
+      {
+        newDimension = std::max(newDimension, (size_t) 1);
+        Transform(data, mean, scale, eigvec.cols(0, newDimension - 1), data);
+
+        return (totalVariance == 0) ? 1.0 :
+            sum(eigval.subvec(0, newDimension - 1)) / totalVariance;
+      }
+
+      rank = std::min(2 * rank, (size_t) data.n_rows);
+    }
+  }
+
+  //! Get whether or not the data will be scaled by standard deviation.
+  bool ScaleData() const { return scaleData; }
+  //! Modify whether or not the data will be scaled by standard deviation.
+  bool& ScaleData() { return scaleData; }
+
+  //! Get the number of extra dimensions in the random subspace.
+  size_t Oversampling() const { return oversampling; }
+  //! Modify the number of extra dimensions in the random subspace.
+  size_t& Oversampling() { return oversampling; }
+
+  //! Get the number of power iterations.
+  size_t PowerIterations() const { return powerIterations; }
+  //! Modify the number of power iterations.
+  size_t& PowerIterations() { return powerIterations; }
+
+ private:
+  //! Whether or not the data will be scaled by standard deviation.
+  bool scaleData;
+  //! Number of extra dimensions in the random subspace.
+  size_t oversampling;
+  //! Number of power iterations.
+  size_t powerIterations;
+  //! Number of points in each block of a pass over the data.
+  size_t blockSize;
+
+  /**
+   * Compute the mean and the scale (standard deviation, or one) of each
+   * dimension in one pass, and return the total variance of the (scaled) data.
+   */
+  double Statistics(const arma::mat& data,
+                    arma::vec& mean,
+                    arma::vec& scale) const
+  {
+    mean = arma::mean(data, 1);
+
+    arma::vec variance = arma::zeros<arma::vec>(data.n_rows);
+    const size_t blocks = (data.n_cols + blockSize - 1) / blockSize;
+
+    #pragma omp parallel
+    {
+      arma::vec threadVariance = arma::zeros<arma::vec>(data.n_rows);
+      arma::mat block;
+
+      #pragma omp for schedule(static)
+      for (size_t b = 0; b < blocks; ++b)
+      {
+        const size_t end = std::min((b + 1) * blockSize, (size_t) data.n_cols);
+        block = data.cols(b * blockSize, end - 1);
+        block.each_col() -= mean;
+        threadVariance += arma::sum(arma::square(block), 1);
+      }
+
+      #pragma omp critical
+      variance += threadVariance;
+    }
+
+    variance /= std::max((double) data.n_cols - 1, 1.0);
+
+    scale.ones(data.n_rows);
+    if (scaleData)
+    {
+      // Dimensions with no variance are left as they are.
+      for (size_t i = 0; i < data.n_rows; ++i)
+        if (variance[i] > 0)
+          scale[i] = sqrt(variance[i]);
+
+      return (double) accu(variance > 0);
+    }
+
+    return sum(variance);
+  }
+
+  /**
+   * Compute output = A A^T x in one pass over the data, where A is the
+   * centered and scaled data, one block of columns at a time (in parallel).
+   */
+  void CovarianceProduct(const arma::mat& data,
+                         const arma::vec& mean,
+                         const arma::vec& scale,
+                         const arma::mat& x,
+                         arma::mat& output) const
+  {
+    output.zeros(data.n_rows, x.n_cols);
+    const size_t blocks = (data.n_cols + blockSize - 1) / blockSize;
+
+    #pragma omp parallel
+    {
+      arma::mat threadOutput = arma::zeros<arma::mat>(data.n_rows, x.n_cols);
+      arma::mat block;
+
+      #pragma omp for schedule(dynamic)
+      for (size_t b = 0; b < blocks; ++b)
+      {
+        const size_t end = std::min((b + 1) * blockSize, (size_t) data.n_cols);
+        block = data.cols(b * blockSize, end - 1);
+        block.each_col() -= mean;
+        block.each_col() /= scale;
+
+        threadOutput += block * (trans(block) * x);
+      }
+
+      #pragma omp critical
+      output += threadOutput;
+    }
+  }
+
+  /**
+   * Find the leading rank eigenvalues and eigenvectors of the covariance of
+   * the centered and scaled data, with randomized subspace iteration followed
+   * by a Rayleigh-Ritz step.
+   */
+  void Decompose(const arma::mat& data,
+                 const arma::vec& mean,
+                 const arma::vec& scale,
+                 const size_t rank,
+                 arma::vec& eigval,
+                 arma::mat& eigvec) const
+  {
+    const size_t newDimension = std::max(std::min(rank, (size_t) data.n_rows),
+        (size_t) 1);
+    const size_t subspace = std::min(newDimension + oversampling,
+        (size_t) data.n_rows);
+
+    // Random starting subspace, multiplied by the covariance (powerIterations +
+    // 1) times, with re-orthogonalization in between for stability.
+    arma::mat q, r, y;
+    arma::mat omega = arma::randn<arma::mat>(data.n_rows, subspace);
+    CovarianceProduct(data, mean, scale, omega, y);
+    for (size_t i = 0; i < powerIterations; ++i)
+    {
+      arma::qr_econ(q, r, y);
+      CovarianceProduct(data, mean, scale, q, y);
+    }
+    arma::qr_econ(q, r, y);
+
+    // The covariance restricted to the subspace spanned by q.
+    arma::mat cq;
+    CovarianceProduct(data, mean, scale, q, cq);
+    const arma::mat small = arma::symmatu(trans(q) * cq);
+
+    arma::vec smallEigval;
+    arma::mat smallEigvec;
+    arma::eig_sym(smallEigval, smallEigvec, small);
+
+    // The eigenvalues are in ascending order; keep the largest ones.
+    eigval.set_size(newDimension);
+    eigvec.set_size(data.n_rows, newDimension);
+    const double normalization = std::max((double) data.n_cols - 1, 1.0);
+    for (size_t i = 0; i < newDimension; ++i)
+    {
+      const size_t index = smallEigval.n_elem - 1 - i;
+      eigval[i] = std::max(smallEigval[index], 0.0) / normalization;
+      eigvec.col(i) = q * smallEigvec.col(index);
+    }
+  }
+
+  /**
+   * Project the centered and scaled data onto the given components, one block
+   * of columns at a time (in parallel).  It is safe for output to be data.
+   */
+  void Transform(const arma::mat& data,
+                 const arma::vec& mean,
+                 const arma::vec& scale,
+                 const arma::mat& eigvec,
+                 arma::mat& output) const
+  {
+    arma::mat transformed(eigvec.n_cols, data.n_cols);
+    const size_t blocks = (data.n_cols + blockSize - 1) / blockSize;
+
+    #pragma omp parallel
+    {
+      arma::mat block;
+
+      #pragma omp for schedule(static)
+      for (size_t b = 0; b < blocks; ++b)
+      {
+        const size_t end = std::min((b + 1) * blockSize, (size_t) data.n_cols);
+        block = data.cols(b * blockSize, end - 1);
+        block.each_col() -= mean;
+        block.each_col() /= scale;
+
+        transformed.cols(b * blockSize, end - 1) = trans(eigvec) * block;
+      }
+    }
+
+    output = transformed;
+  }
+};
+
+}; // namespace pca
+}; // namespace mlpack
+
+#endif
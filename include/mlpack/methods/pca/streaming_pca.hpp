@@ -0,0 +1,352 @@
+/**
+ * @file streaming_pca.hpp
+ *
+ * Principal components analysis from a covariance matrix that is accumulated in
+ * a single pass over blocks of columns, so that the data never has to be held
+ * in memory (or centered) all at once.
+ *
+ * This file is part of MLPACK 1.0.10.
+ *
+ * MLPACK is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * MLPACK is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details (LICENSE.txt).
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * MLPACK.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __MLPACK_METHODS_PCA_STREAMING_PCA_HPP
+#define __MLPACK_METHODS_PCA_STREAMING_PCA_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace pca {
+
+/**
+ * This class accumulates the mean and the scatter matrix (the unnormalized
+ * covariance) of a dataset that is given as a sequence of blocks of columns.
+ * The statistics of each block are computed around the block's own mean, and
+ * are merged into the running statistics with the pairwise update of Chan,
+ * Golub and LeVeque, so that the result is numerically stable no matter how far
+ * the data is from the origin.  Large blocks are split into chunks whose
+ * statistics are computed in parallel, and merged in a fixed order.
+ *
+ * Once all the blocks have been added, the principal components are found from
+ * the d x d covariance matrix, and blocks can be projected onto them (in a
+ * second pass over the data, if it does not fit in memory):
+ *
+ * @code
+ * StreamingPCA p;
+ * for (size_t i = 0; i < blocks; ++i)
+ *   p.Add(LoadBlock(i));
+ *
+ * arma::vec eigval;
+ * arma::mat eigvec;
+ * p.Decompose(eigval, eigvec);
+ *
+ * arma::mat transformed;
+ * p.Transform(LoadBlock(0), eigvec.cols(0, 9), transformed);
+ * @endcode
+ *
+ * The Apply() overloads mirror those of PCA (and reset any accumulated
+ * statistics), so this class can also be used in its place for data that is in
+ * memory.
+ */
+class StreamingPCA
+{
+ public:
+  /**
+   * Create the StreamingPCA object, with no accumulated statistics.
+   *
+   * @param scaleData Whether or not to scale the data in each dimension by its
+   *     standard deviation.
+   * @param chunkSize Number of points in each chunk that is processed in
+   *     parallel.
+   */
+  StreamingPCA(const bool scaleData = false, const size_t chunkSize = 4096) :
+      scaleData(scaleData),
+      chunkSize(std::max(chunkSize, (size_t) 1)),
+      points(0)
+  { }
+
+  //! Forget all of the accumulated statistics.
+  void Reset()
+  {
+    points = 0;
+    mean.reset();
+    scatter.reset();
+  }
+
+  /**
+   * Add a block of points (one per column) to the accumulated statistics.
+   *
+   * @param block Points to add.
+   */
+  void Add(const arma::mat& block)
+  {
+    if (block.n_cols == 0)
+      return;
+
+    if (points == 0)
+    {
+      mean.zeros(block.n_rows);
+      scatter.zeros(block.n_rows, block.n_rows);
+    }
+    else if (block.n_rows != mean.n_elem)
+    {
+      Log::Fatal << "StreamingPCA::Add(): block has " << block.n_rows
+          << " dimensions, but the accumulated data has " << mean.n_elem
+          << "." << std::endl;
+    }
+
+    // Compute the statistics of each chunk around its own mean.
+    const size_t chunks = (block.n_cols + chunkSize - 1) / chunkSize;
+    std::vector<arma::vec> chunkMeans(chunks);
+    std::vector<arma::mat> chunkScatters(chunks);
+
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t c = 0; c < chunks; ++c)
+    {
+      const size_t end = std::min((c + 1) * chunkSize, (size_t) block.n_cols);
+      arma::mat centered = block.cols(c * chunkSize, end - 1);
+      chunkMeans[c] = arma::mean(centered, 1);
+      centered.each_col() -= chunkMeans[c];
+      chunkScatters[c] = centered * trans(centered);
+    }
+
+    // Merge them into the running statistics, in order.
+    for (size_t c = 0; c < chunks; ++c)
+    {
+      const size_t count = std::min((c + 1) * chunkSize, (size_t) block.n_cols)
+          - c * chunkSize;
+      const double total = (double) (points + count);
+      const arma::vec delta = chunkMeans[c] - mean;
+
+      scatter += chunkScatters[c] +
+          (((double) points * (double) count) / total) * (delta * trans(delta));
+      mean += (count / total) * delta;
+      points += count;
+    }
+  }
+
+  //! Get the number of points added so far.
+  size_t Points() const { return points; }
+  //! Get the mean of the points added so far.
+  const arma::vec& Mean() const { return mean; }
+
+  /**
+   * Get the covariance matrix of the points added so far (or the correlation
+   * matrix, if the data is scaled).
+   */
+  arma::mat Covariance() const
+  {
+    arma::mat covariance = scatter / std::max((double) points - 1, 1.0);
+    if (scaleData)
+    {
+      const arma::vec scale = Scale();
+      covariance.each_col() /= scale;
+      covariance.each_row() /= trans(scale);
+    }
+
+    return covariance;
+  }
+
+  /**
+   * Find all of the principal components of the points added so far, in
+   * descending order of eigenvalue.
+   *
+   * @param eigval Vector to put the eigenvalues of the covariance matrix into.
+   * @param eigvec Matrix to put the eigenvectors (loadings) into.
+   */
+  void Decompose(arma::vec& eigval, arma::mat& eigvec) const
+  {
+    if (points == 0)
+      Log::Fatal << "StreamingPCA::Decompose(): no points have been added!"
+          << std::endl;
+
+    arma::eig_sym(eigval, eigvec, Covariance());
+
+    // Eigenvalues are in ascending order; we want them descending.
+    eigval = arma::flipud(eigval);
+    eigvec = arma::fliplr(eigvec);
+  }
+
+  /**
+   * Center (and possibly scale) a block of points with the accumulated
+   * statistics, and project it onto the given principal components.
+   *
+   * @param block Points to transform.
+   * @param eigvec Principal components to project onto.
+   * @param output Matrix to put the transformed points into.
+   */
+  void Transform(const arma::mat& block,
+                 const arma::mat& eigvec,
+                 arma::mat& output) const
+  {
+    arma::mat transformed(eigvec.n_cols, block.n_cols);
+    const arma::vec scale = Scale();
+    const size_t chunks = (block.n_cols + chunkSize - 1) / chunkSize;
+
+    #pragma omp parallel for schedule(static)
+    for (size_t c = 0; c < chunks; ++c)
+    {
+      const size_t end = std::min((c + 1) * chunkSize, (size_t) block.n_cols);
+      arma::mat centered = block.cols(c * chunkSize, end - 1);
+      centered.each_col() -= mean;
+      centered.each_col() /= scale;
+
+      transformed.cols(c * chunkSize, end - 1) = trans(eigvec) * centered;
+    }
+
+    output = transformed;
+  }
+
+  /**
+   * Apply principal components analysis to the given dataset.  Any
+   * accumulated statistics are replaced by those of this dataset.  It is safe
+   * to pass the same matrix reference for both data and transformedData.
+   *
+   * @param data Data matrix.
+   * @param transformedData Matrix to put results of PCA into.
+   * @param eigval Vector to put eigenvalues into.
+   * @param eigvec Matrix to put eigenvectors (loadings) into.
+   */
+  void Apply(const arma::mat& data,
+             arma::mat& transformedData,
+             arma::vec& eigval,
+             arma::mat& eigvec)
+  {
+    Reset();
+    Add(data);
+    Decompose(eigval, eigvec);
+    Transform(data, eigvec, transformedData);
+  }
+
+  /**
+   * Use PCA for dimensionality reduction on the given dataset.  This will save
+   * the newDimension largest principal components of the data and remove the
+   * rest.  Any accumulated statistics are replaced by those of this dataset.
+   *
+   * @param data Data matrix.
+   * @param newDimension New dimension of the data.
+   * @return Amount of the variance of the data retained (between 0 and 1).
+   */
+  double Apply(arma::mat& data, const size_t newDimension)
+  {
+    if (newDimension == 0)
+      Log::Fatal << "StreamingPCA::Apply(): newDimension (" << newDimension
+          << ") cannot be zero!" << std::endl;
+    if (newDimension > data.n_rows)
+      Log::Fatal << "StreamingPCA::Apply(): newDimension (" << newDimension
+          << ") cannot be greater than the existing dimensionality of the "
+          << "data (" << data.n_rows << ")!" << std::endl;
+
+    Reset();
+    Add(data);
+
+    arma::vec eigval;
+    arma::mat eigvec;
+    Decompose(eigval, eigvec);
+    Transform(data, eigvec.cols(0, newDimension - 1), data);
+
+    return Retained(eigval, newDimension);
+  }
+
+  //! This overload is here to make sure int gets casted right to size_t.
+  inline double Apply(arma::mat& data, const int newDimension)
+  {
+    return Apply(data, size_t(newDimension));
+  }
+
+  /**
+   * Use PCA for dimensionality reduction on the given dataset.  This will save
+   * as many dimensions as necessary to retain at least the given amount of
+   * variance.  Any accumulated statistics are replaced by those of this
+   * dataset.
+   *
+   * @param data Data matrix.
+   * @param varRetained Lower bound on amount of variance to retain; should be
+   *     between 0 and 1.
+   * @return Actual amount of variance retained (between 0 and 1).
+   */
+  double Apply(arma::mat& data, const double varRetained)
+  {
+    if (varRetained < 0)
+      Log::Fatal << "StreamingPCA::Apply(): varRetained (" << varRetained
+          << ") must be greater than or equal to 0." << std::endl;
+    if (varRetained > 1)
+      Log::Fatal << "StreamingPCA::Apply(): varRetained (" << varRetained
+          << ") should be less than or equal to 1." << std::endl;
+
+    Reset();
+    Add(data);
+
+    arma::vec eigval;
+    arma::mat eigvec;
+    Decompose(eigval, eigvec);
+
+    // Find how many components are needed.
+    size_t newDimension = 1;
+    while (newDimension < eigval.n_elem &&
+        Retained(eigval, newDimension) < varRetained)
+      ++newDimension;
+
+    Transform(data, eigvec.cols(0, newDimension - 1), data);
+
+    return Retained(eigval, newDimension);
+  }
+
+  //! Get whether or not the data will be scaled by standard deviation.
+  bool ScaleData() const { return scaleData; }
+  //! Modify whether or not the data will be scaled by standard deviation.
+  bool& ScaleData() { return scaleData; }
+
+ private:
+  //! Whether or not the data will be scaled by standard deviation.
+  bool scaleData;
+  //! Number of points in each chunk that is processed in parallel.
+  size_t chunkSize;
+
+  //! Number of points added so far.
+  size_t points;
+  //! Mean of the points added so far.
+  arma::vec mean;
+  //! Sum of the outer products of the centered points added so far.
+  arma::mat scatter;
+
+  /**
+   * Get the scale of each dimension: the standard deviation if the data is
+   * scaled (or one, for dimensions with no variance), and one otherwise.
+   */
+  arma::vec Scale() const
+  {
+    arma::vec scale = arma::ones<arma::vec>(mean.n_elem);
+    if (scaleData)
+    {
+      const double normalization = std::max((double) points - 1, 1.0);
+      for (size_t i = 0; i < mean.n_elem; ++i)
+        if (scatter(i, i) > 0)
+          scale[i] = sqrt(scatter(i, i) / normalization);
+    }
+
+    return scale;
+  }
+
+  //! Get the fraction of the variance in the first newDimension components.
+  static double Retained(const arma::vec& eigval, const size_t newDimension)
+  {
+    const double total = sum(eigval);
+    return (total == 0) ? 1.0 : sum(eigval.subvec(0, newDimension - 1)) / total;
+  }
+};
+
+}; // namespace pca
+}; // namespace mlpack
+
+#endif
@@ -24,6 +24,7 @@
 
 #include <mlpack/core.hpp>
 #include <mlpack/core/tree/cosine_tree/cosine_tree.hpp>
+#include <mlpack/core/tree/cosine_tree/parallel_cosine_tree.hpp>
 
 namespace mlpack {
 namespace svd {
@@ -33,11 +34,11 @@ class QUIC_SVD
  public:
 
   /**
-   * Constructor which implements the QUIC-SVD algorithm. The function calls the
-   * CosineTree constructor to create a subspace basis, where the original
-   * matrix's projection has minimum reconstruction error. The constructor then
-   * uses the ExtractSVD() function to calculate the SVD of the original dataset
-   * in that subspace.
+   * Constructor which implements the QUIC-SVD algorithm. The function builds a
+   * cosine tree (with ParallelCosineTree, which splits several nodes at a time)
+   * to create a subspace basis, where the original matrix's projection has
+   * minimum reconstruction error. The constructor then uses the ExtractSVD()
+   * function to calculate the SVD of the original dataset in that subspace.
    *
    * @param dataset Matrix for which SVD is calculated.
    * @param u First unitary matrix.
@@ -45,13 +46,16 @@ class QUIC_SVD
    * @param sigma Diagonal matrix of singular values.
    * @param epsilon Error tolerance fraction for calculated subspace.
    * @param delta Cumulative probability for Monte Carlo error lower bound.
+   * @param splitsPerRound Number of cosine tree nodes split at a time; if 0,
+   *     the number of threads is used.
    */
   QUIC_SVD(const arma::mat& dataset,
            arma::mat& u,
            arma::mat& v,
            arma::mat& sigma,
            const double epsilon = 0.03,
-           const double delta = 0.1);
+           const double delta = 0.1,
+           const size_t splitsPerRound = 0);
 
   /**
    * This function uses the vector subspace created using a cosine tree to
@@ -35,21 +35,26 @@ QUIC_SVD::QUIC_SVD(const arma::mat& dataset,
                    arma::mat& v,
                    arma::mat& sigma,
                    const double epsilon,
-                   const double delta) :
+                   const double delta,
+                   const size_t splitsPerRound) :
     dataset(dataset),
     epsilon(epsilon),
     delta(delta)
 {
   // Since columns are sample in the implementation, the matrix is transposed if
-  // necessary for maximum speedup.
-  CosineTree* ctree;
+  // necessary for maximum speedup.  The tree only holds a reference to its
+  // matrix, so the transpose has to outlive it.
   if (dataset.n_cols > dataset.n_rows)
-    ctree = new CosineTree(dataset, epsilon, delta);
+  {
+    ParallelCosineTree ctree(dataset, epsilon, delta, splitsPerRound);
+    ctree.GetFinalBasis(basis);
+  }
   else
-    ctree = new CosineTree(dataset.t(), epsilon, delta);
-
-  // Get subspace basis by creating the cosine tree.
-  ctree->GetFinalBasis(basis);
+  {
+    const arma::mat transposed = trans(dataset);
+    ParallelCosineTree ctree(transposed, epsilon, delta, splitsPerRound);
+    ctree.GetFinalBasis(basis);
+  }
 
   // Use the ExtractSVD algorithm mentioned in the paper to extract the SVD of
   // the original dataset in the obtained subspace.
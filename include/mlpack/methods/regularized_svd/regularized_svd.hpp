@@ -25,6 +25,7 @@
 
 #include <mlpack/core.hpp>
 #include <mlpack/core/optimizers/sgd/sgd.hpp>
+#include <mlpack/core/optimizers/parallel_sgd/parallel_sgd.hpp>
 
 #include "regularized_svd_function.hpp"
 
@@ -43,6 +44,14 @@ class RegularizedSVD
    * training on the passed data. The constructor initiates an object of class
    * RegularizedSVDFunction for optimization. It uses the SGD optimizer by
    * default. The optimizer uses a template specialization of Optimize().
+   * ParallelSGD can be used instead to train with many threads at once; each
+   * of its steps is a single call to
+   * RegularizedSVDFunction::EvaluateAndUpdate(), which only touches the user
+   * and item vectors of one rating:
+   *
+   * @code
+   * RegularizedSVD<optimization::ParallelSGD> rSVD(data, u, v, rank);
+   * @endcode
    *
    * @param data Dataset for which SVD is calculated.
    * @param u User matrix in the matrix decomposition.
@@ -72,8 +81,8 @@ class RegularizedSVD
   double lambda;
   //! Function that will be held by the optimizer.
   RegularizedSVDFunction rSVDFunc;
-  //! Default SGD optimizer for the class.
-  mlpack::optimization::SGD<RegularizedSVDFunction> optimizer;
+  //! Optimizer for the class (SGD by default).
+  OptimizerType<RegularizedSVDFunction> optimizer;
 };
 
 }; // namespace svd
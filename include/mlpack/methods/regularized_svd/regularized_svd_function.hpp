@@ -73,6 +73,71 @@ class RegularizedSVDFunction
   void Gradient(const arma::mat& parameters,
                 arma::mat& gradient) const;
   
+  /**
+   * Take a gradient step with respect to one training example, directly on
+   * the given parameters; that is, perform parameters -= stepSize * gradient,
+   * where the gradient is that of Evaluate(parameters, i).  Only the user and
+   * item vectors of the example are touched, so this is used by ParallelSGD to
+   * let many threads update the parameters at once without locking.
+   *
+   * @param parameters Parameters(user/item matrices) of the decomposition.
+   * @param i Index of the training example to be used.
+   * @param stepSize Step size of the gradient step.
+   */
+  void UpdateIterate(arma::mat& parameters,
+                     const size_t i,
+                     const double stepSize) const
+  {
+    EvaluateAndUpdate(parameters, i, stepSize);
+  }
+
+  /**
+   * Evaluate the cost function for one training example, and then take the
+   * gradient step of UpdateIterate().  The rating error and the norms of the
+   * user and item vectors are computed in the same pass over the two vectors,
+   * and then both vectors are updated in a second pass, so each step costs
+   * O(rank) time.  ParallelSGD uses this instead of separate calls to
+   * Evaluate() and UpdateIterate().
+   *
+   * @param parameters Parameters(user/item matrices) of the decomposition.
+   * @param i Index of the training example to be used.
+   * @param stepSize Step size of the gradient step.
+   * @return Cost function for the example, before the step.
+   */
+  double EvaluateAndUpdate(arma::mat& parameters,
+                           const size_t i,
+                           const double stepSize) const
+  {
+    const size_t user = data(0, i);
+    const size_t item = data(1, i) + numUsers;
+
+    double* userVec = parameters.colptr(user);
+    double* itemVec = parameters.colptr(item);
+
+    double ratingError = data(2, i);
+    double userNormSquared = 0;
+    double itemNormSquared = 0;
+    for (size_t k = 0; k < rank; ++k)
+    {
+      ratingError -= userVec[k] * itemVec[k];
+      userNormSquared += userVec[k] * userVec[k];
+      itemNormSquared += itemVec[k] * itemVec[k];
+    }
+
+    for (size_t k = 0; k < rank; ++k)
+    {
+      const double userValue = userVec[k];
+      const double itemValue = itemVec[k];
+      userVec[k] -= 2 * stepSize * (lambda * userValue -
+          ratingError * itemValue);
+      itemVec[k] -= 2 * stepSize * (lambda * itemValue -
+          ratingError * userValue);
+    }
+
+    return ratingError * ratingError +
+        lambda * (userNormSquared + itemNormSquared);
+  }
+
   //! Return the initial point for the optimization.
   const arma::mat& GetInitialPoint() const { return initialPoint; }
   
@@ -24,6 +24,7 @@
 
 #include <mlpack/core.hpp>
 #include <mlpack/core/optimizers/lbfgs/lbfgs.hpp>
+#include <mlpack/core/optimizers/sgd/sgd.hpp>
 
 #include "sparse_autoencoder_function.hpp"
 
@@ -67,7 +68,17 @@ namespace nn {
  * @endcode
  *
  * This implementation allows the use of arbitrary mlpack optimizers via the
- * OptimizerType template parameter.
+ * OptimizerType template parameter.  For large datasets, mini-batch SGD is
+ * usually much faster than L-BFGS on the full batch:
+ *
+ * @code
+ * // Take steps with mini-batches of 256 points (each mini-batch is split
+ * // into blocks over the available threads).
+ * SparseAutoencoderFunction saf(data, vSize, hSize);
+ * SGD<SparseAutoencoderFunction> sgd(saf, 0.1, 10 * data.n_cols / 256, 1e-5,
+ *     true, 256);
+ * SparseAutoencoder<SGD> encoder3(sgd);
+ * @endcode
  *
  * @tparam OptimizerType The optimizer to use; by default this is L-BFGS.  Any
  *     mlpack optimizer can be used here.
@@ -80,6 +80,95 @@ class SparseAutoencoderFunction
    */
   void Gradient(const arma::mat& parameters, arma::mat& gradient) const;
 
+  /**
+   * Evaluates both the objective function and its gradient given the current
+   * set of parameters.  This is equivalent to calling Evaluate() and then
+   * Gradient(), but the feedforward pass is only performed once, so
+   * optimizers which support it (such as L_BFGS) need about half the work.
+   * The data is split into blocks of columns, one per thread, and the
+   * feedforward and backpropagation passes over the blocks are run in
+   * parallel (if OpenMP is available).
+   *
+   * @param parameters Current values of the model parameters.
+   * @param gradient Matrix where gradient values will be stored.
+   * @return Value of the objective function.
+   */
+  double EvaluateWithGradient(const arma::mat& parameters,
+                              arma::mat& gradient) const
+  {
+    return RangeEvaluateWithGradient(parameters, 0, data.n_cols, gradient);
+  }
+
+  /**
+   * Evaluates the objective function and its gradient on the mini-batch of
+   * points begin, ..., begin + batchSize - 1, for mini-batch SGD (see
+   * mlpack::optimization::SGD).  The result is batchSize times the objective
+   * (and gradient) of the sparse autoencoder trained on only the mini-batch;
+   * in particular, the sparsity penalty uses the average activations of the
+   * whole mini-batch.  Summed over all of the mini-batches, this is
+   * approximately the number of points times the full objective, so the step
+   * size of SGD does not depend on the size of the dataset.
+   *
+   * Because of the sparsity penalty, the objective of a mini-batch is not the
+   * sum of the objectives of its parts, so ShardBatches() tells SGD not to
+   * split the mini-batch; instead, the mini-batch is split into blocks of
+   * columns which are run in parallel here, as for the full batch.
+   *
+   * @param parameters Current values of the model parameters.
+   * @param begin Index of the first point of the mini-batch.
+   * @param batchSize Number of points in the mini-batch.
+   * @param gradient Matrix where gradient values will be stored.
+   * @return Value of the objective function.
+   */
+  double EvaluateWithGradient(const arma::mat& parameters,
+                              const size_t begin,
+                              const size_t batchSize,
+                              arma::mat& gradient) const
+  {
+    const double objective = RangeEvaluateWithGradient(parameters, begin,
+        batchSize, gradient);
+
+    gradient *= batchSize;
+    return batchSize * objective;
+  }
+
+  //! The mini-batches must not be split into shards by SGD, since the sparsity
+  //! penalty depends on the average activations of the whole mini-batch.
+  bool ShardBatches() const { return false; }
+
+  /**
+   * Evaluates the objective function on only the given point, as for the
+   * mini-batch EvaluateWithGradient() with a mini-batch of one point.
+   *
+   * @param parameters Current values of the model parameters.
+   * @param i Index of the point.
+   */
+  double Evaluate(const arma::mat& parameters, const size_t i) const
+  {
+    arma::mat gradient;
+    return EvaluateWithGradient(parameters, i, 1, gradient);
+  }
+
+  /**
+   * Evaluates the gradient of the objective function on only the given point,
+   * as for the mini-batch EvaluateWithGradient() with a mini-batch of one
+   * point.
+   *
+   * @param parameters Current values of the model parameters.
+   * @param i Index of the point.
+   * @param gradient Matrix where gradient values will be stored.
+   */
+  void Gradient(const arma::mat& parameters,
+                const size_t i,
+                arma::mat& gradient) const
+  {
+    EvaluateWithGradient(parameters, i, 1, gradient);
+  }
+
+  //! Return the number of points, which is the number of functions the
+  //! objective can be decomposed into for SGD.
+  size_t NumFunctions() const { return data.n_cols; }
+
   /**
    * Returns the elementwise sigmoid of the passed matrix, where the sigmoid
    * function of a real number 'x' is [1 / (1 + exp(-x))].
@@ -155,6 +244,168 @@ class SparseAutoencoderFunction
   }
 
  private:
+  /**
+   * Evaluate the objective function and its gradient as if the data were only
+   * the points begin, ..., begin + count - 1.  The points are split into
+   * blocks of columns, one per thread, and the feedforward and
+   * backpropagation passes over the blocks are run in parallel (if OpenMP is
+   * available).
+   */
+  double RangeEvaluateWithGradient(const arma::mat& parameters,
+                                   const size_t begin,
+                                   const size_t count,
+                                   arma::mat& gradient) const
+  {
+    const size_t blocks = std::max((size_t) 1,
+        std::min((size_t) omp_get_max_threads(), count));
+
+    // The sparsity penalty depends on the average activations of the hidden
+    // layer over all of the points, so the feedforward pass to the hidden layer
+    // is done for every block before any block can be backpropagated.
+    std::vector<arma::mat> hiddenLayers(blocks);
+    arma::mat hiddenSums(hiddenSize, blocks);
+    #pragma omp parallel for schedule(static) if (blocks > 1)
+    for (size_t block = 0; block < blocks; ++block)
+    {
+      const size_t blockBegin = BlockBegin(begin, count, block, blocks);
+      HiddenLayer(parameters, blockBegin, BlockBegin(begin, count, block + 1,
+          blocks) - blockBegin, hiddenLayers[block]);
+      hiddenSums.col(block) = arma::sum(hiddenLayers[block], 1);
+    }
+
+    const arma::vec rhoCap = arma::sum(hiddenSums, 1) / count;
+
+    std::vector<arma::mat> blockGradients(blocks);
+    arma::vec reconstructionErrors(blocks);
+    #pragma omp parallel for schedule(static) if (blocks > 1)
+    for (size_t block = 0; block < blocks; ++block)
+    {
+      const size_t blockBegin = BlockBegin(begin, count, block, blocks);
+      reconstructionErrors[block] = Backpropagate(parameters, blockBegin,
+          BlockBegin(begin, count, block + 1, blocks) - blockBegin,
+          hiddenLayers[block], rhoCap, blockGradients[block]);
+    }
+
+    // Sum the gradients of the blocks in a fixed order.
+    gradient = blockGradients[0];
+    for (size_t block = 1; block < blocks; ++block)
+      gradient += blockGradients[block];
+
+    return Regularize(parameters, rhoCap, count,
+        arma::accu(reconstructionErrors), gradient);
+  }
+
+  //! Get the first point of the given block (of the given number of blocks) of
+  //! the points begin, ..., begin + count - 1.
+  size_t BlockBegin(const size_t begin,
+                    const size_t count,
+                    const size_t block,
+                    const size_t blocks) const
+  {
+    return begin + (block * count) / blocks;
+  }
+
+  /**
+   * Compute the activations of the hidden layer for the points begin, ...,
+   * begin + count - 1.
+   */
+  void HiddenLayer(const arma::mat& parameters,
+                   const size_t begin,
+                   const size_t count,
+                   arma::mat& hiddenLayer) const
+  {
+    // The parameters are laid out as
+    //   [ W1 b1 ]  (hiddenSize x (visibleSize + 1))
+    //   [ W2' 0 ]  (hiddenSize x (visibleSize + 1))
+    //   [ b2' 0 ]  (1 x (visibleSize + 1)).
+    const size_t l1 = hiddenSize;
+    const size_t l2 = visibleSize;
+
+    Sigmoid(parameters.submat(0, 0, l1 - 1, l2 - 1) *
+        data.cols(begin, begin + count - 1) +
+        arma::repmat(parameters.submat(0, l2, l1 - 1, l2), 1, count),
+        hiddenLayer);
+  }
+
+  /**
+   * Finish the feedforward pass for the points begin, ..., begin + count - 1
+   * given their hidden layer activations, and backpropagate the error.  The
+   * gradient is set to the sum over the points of the gradient of the
+   * reconstruction error and the sparsity penalty (with the given average
+   * activations) with respect to each parameter; regularization and scaling
+   * are left to Regularize().
+   *
+   * @return The reconstruction error of the points.
+   */
+  double Backpropagate(const arma::mat& parameters,
+                       const size_t begin,
+                       const size_t count,
+                       const arma::mat& hiddenLayer,
+                       const arma::vec& rhoCap,
+                       arma::mat& gradient) const
+  {
+    const size_t l1 = hiddenSize;
+    const size_t l2 = visibleSize;
+    const size_t l3 = 2 * hiddenSize;
+
+    arma::mat outputLayer;
+    Sigmoid(parameters.submat(l1, 0, l3 - 1, l2 - 1).t() * hiddenLayer +
+        arma::repmat(parameters.submat(l3, 0, l3, l2 - 1).t(), 1, count),
+        outputLayer);
+
+    const arma::mat diff = outputLayer - data.cols(begin, begin + count - 1);
+
+    const arma::vec klDivGrad = beta * (-(rho / rhoCap) +
+        (1 - rho) / (1 - rhoCap));
+    const arma::mat delOut = diff % outputLayer % (1 - outputLayer);
+    const arma::mat delHid = (parameters.submat(l1, 0, l3 - 1, l2 - 1) *
+        delOut + arma::repmat(klDivGrad, 1, count)) % hiddenLayer %
+        (1 - hiddenLayer);
+
+    gradient.zeros(2 * hiddenSize + 1, visibleSize + 1);
+    gradient.submat(0, 0, l1 - 1, l2 - 1) = delHid *
+        data.cols(begin, begin + count - 1).t();
+    gradient.submat(l1, 0, l3 - 1, l2 - 1) = hiddenLayer * delOut.t();
+    gradient.submat(0, l2, l1 - 1, l2) = arma::sum(delHid, 1);
+    gradient.submat(l3, 0, l3, l2 - 1) = arma::sum(delOut, 1).t();
+
+    return 0.5 * arma::accu(diff % diff);
+  }
+
+  /**
+   * Given the reconstruction error and the gradient from Backpropagate()
+   * summed over n points, scale them by 1 / n and add the weight decay and
+   * the sparsity penalty.
+   *
+   * @return The value of the objective function.
+   */
+  double Regularize(const arma::mat& parameters,
+                    const arma::vec& rhoCap,
+                    const double n,
+                    const double reconstructionError,
+                    arma::mat& gradient) const
+  {
+    const size_t l1 = hiddenSize;
+    const size_t l2 = visibleSize;
+    const size_t l3 = 2 * hiddenSize;
+
+    // The objective has terms for the reconstruction error, the weight decay,
+    // and the KL divergence of the average activations from rho.
+    const double weightDecay = 0.5 * lambda *
+        (arma::accu(arma::square(parameters.submat(0, 0, l1 - 1, l2 - 1))) +
+         arma::accu(arma::square(parameters.submat(l1, 0, l3 - 1, l2 - 1))));
+    const double klDivergence = arma::accu(rho * arma::log(rho / rhoCap) +
+        (1 - rho) * arma::log((1 - rho) / (1 - rhoCap)));
+
+    gradient /= n;
+    gradient.submat(0, 0, l1 - 1, l2 - 1) += lambda *
+        parameters.submat(0, 0, l1 - 1, l2 - 1);
+    gradient.submat(l1, 0, l3 - 1, l2 - 1) += lambda *
+        parameters.submat(l1, 0, l3 - 1, l2 - 1);
+
+    return reconstructionError / n + weightDecay + beta * klDivergence;
+  }
+
   //! The matrix of data points.
   const arma::mat& data;
   //! Intial parameter vector.
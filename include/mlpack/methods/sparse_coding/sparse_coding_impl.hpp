@@ -110,14 +110,21 @@ template<typename DictionaryInitializer>
 void SparseCoding<DictionaryInitializer>::OptimizeCode()
 {
   // When using the Cholesky version of LARS, this is correct even if
-  // lambda2 > 0.
-  arma::mat matGram = trans(dictionary) * dictionary;
+  // lambda2 > 0.  The Gram matrix is shared by every point (and every thread).
+  const arma::mat matGram = trans(dictionary) * dictionary;
 
+  // The points are independent, so they can be coded in parallel.  Each LARS
+  // object only holds the state of the regression for one point, and is run
+  // with RegressGram() without the (unsynchronized) global Timer.
+  #pragma omp parallel for schedule(dynamic, 16)
   for (size_t i = 0; i < data.n_cols; ++i)
   {
     // Report progress.
     if ((i % 100) == 0)
+    {
+      #pragma omp critical
       Log::Debug << "Optimization at point " << i << "." << std::endl;
+    }
 
     bool useCholesky = true;
     regression::LARS lars(useCholesky, matGram, lambda1, lambda2);
@@ -126,7 +133,7 @@ void SparseCoding<DictionaryInitializer>::OptimizeCode()
     // place the result directly into that; then we will not need to have an
     // extra copy.
     arma::vec code = codes.unsafe_col(i);
-    lars.Regress(dictionary, data.unsafe_col(i), code, false);
+    lars.RegressGram(trans(dictionary) * data.unsafe_col(i), code, false);
   }
 }
 
@@ -136,52 +143,93 @@ double SparseCoding<DictionaryInitializer>::OptimizeDictionary(
     const arma::uvec& adjacencies,
     const double newtonTolerance)
 {
-  // Count the number of atomic neighbors for each point x^i.
-  arma::uvec neighborCounts = arma::zeros<arma::uvec>(data.n_cols, 1);
+  // The adjacencies are sorted, so the nonzero codes of each point are
+  // contiguous; find where the nonzero codes of each point start.
+  arma::Col<size_t> pointStarts(data.n_cols + 1);
+  size_t l = 0;
+  for (size_t i = 0; i <= data.n_cols; ++i)
+  {
+    while (l < adjacencies.n_elem && (size_t) adjacencies(l) < i * atoms)
+      ++l;
+    pointStarts[i] = l;
+  }
 
-  if (adjacencies.n_elem > 0)
+  // Compute Z X^T and Z Z^T, touching only the nonzero codes; this takes
+  // O(nnz(Z) d) time instead of O(k m d).  Each thread accumulates the terms
+  // of its own points, and we then sum the results.  X Z^T is accumulated
+  // instead of Z X^T so that the updates are to contiguous columns.
+  arma::mat dataCodesT(data.n_rows, atoms);
+  dataCodesT.zeros();
+  arma::mat codesZT(atoms, atoms);
+  codesZT.zeros();
+
+  #pragma omp parallel
   {
-    // This gets the column index.  Intentional integer division.
-    size_t curPointInd = (size_t) (adjacencies(0) / atoms);
+    arma::mat threadDataCodesT(data.n_rows, atoms);
+    threadDataCodesT.zeros();
+    arma::mat threadCodesZT(atoms, atoms);
+    threadCodesZT.zeros();
 
-    size_t nextColIndex = (curPointInd + 1) * atoms;
-    for (size_t l = 1; l < adjacencies.n_elem; ++l)
+    #pragma omp for schedule(static)
+    for (size_t i = 0; i < data.n_cols; ++i)
     {
-      // If l no longer refers to an element in this column, advance the column
-      // number accordingly.
-      if (adjacencies(l) >= nextColIndex)
+      for (size_t a = pointStarts[i]; a < pointStarts[i + 1]; ++a)
       {
-        curPointInd = (size_t) (adjacencies(l) / atoms);
-        nextColIndex = (curPointInd + 1) * atoms;
+        const size_t j = adjacencies(a) - i * atoms;
+        const double code = codes(j, i);
+        threadDataCodesT.col(j) += code * data.col(i);
+
+        // Only the lower triangle of Z Z^T is accumulated.
+        for (size_t b = pointStarts[i]; b <= a; ++b)
+        {
+          const size_t k = adjacencies(b) - i * atoms;
+          threadCodesZT(j, k) += code * codes(k, i);
+        }
       }
+    }
 
-      ++neighborCounts(curPointInd);
+    #pragma omp critical
+    {
+      dataCodesT += threadDataCodesT;
+      codesZT += threadCodesZT;
     }
   }
 
+  codesZT = symmatl(codesZT);
+
   // Handle the case of inactive atoms (atoms not used in the given coding).
+  // An atom is inactive exactly when its diagonal entry of Z Z^T is zero.
   std::vector<size_t> inactiveAtoms;
+  std::vector<size_t> activeAtoms;
 
   for (size_t j = 0; j < atoms; ++j)
   {
-    if (accu(codes.row(j) != 0) == 0)
+    if (codesZT(j, j) == 0)
       inactiveAtoms.push_back(j);
+    else
+      activeAtoms.push_back(j);
   }
 
   const size_t nInactiveAtoms = inactiveAtoms.size();
   const size_t nActiveAtoms = atoms - nInactiveAtoms;
 
-  // Efficient construction of Z restricted to active atoms.
-  arma::mat matActiveZ;
-  if (nInactiveAtoms > 0)
-  {
-    math::RemoveRows(codes, inactiveAtoms, matActiveZ);
-  }
-
+  // Restrict Z X^T and Z Z^T to the active atoms.
+  arma::mat codesXT;
   if (nInactiveAtoms > 0)
   {
     Log::Warn << "There are " << nInactiveAtoms
         << " inactive atoms. They will be re-initialized randomly.\n";
+
+    arma::uvec activeIndices(nActiveAtoms);
+    for (size_t j = 0; j < nActiveAtoms; ++j)
+      activeIndices[j] = activeAtoms[j];
+
+    codesXT = trans(dataCodesT.cols(activeIndices));
+    codesZT = codesZT.submat(activeIndices, activeIndices);
+  }
+  else
+  {
+    codesXT = trans(dataCodesT);
   }
 
   Log::Debug << "Solving Dual via Newton's Method.\n";
@@ -206,21 +254,6 @@ double SparseCoding<DictionaryInitializer>::OptimizeDictionary(
 
   bool converged = false;
 
-  // If we have any inactive atoms, we must construct these differently.
-  arma::mat codesXT;
-  arma::mat codesZT;
-
-  if (inactiveAtoms.empty())
-  {
-    codesXT = codes * trans(data);
-    codesZT = codes * trans(codes);
-  }
-  else
-  {
-    codesXT = matActiveZ * trans(data);
-    codesZT = matActiveZ * trans(matActiveZ);
-  }
-
   double normGradient;
   double improvement;
   for (size_t t = 1; !converged; ++t)
@@ -247,8 +280,10 @@ double SparseCoding<DictionaryInitializer>::OptimizeDictionary(
     {
       // Calculate objective.
       double sumDualVars = sum(dualVars);
-      double fOld = -(-trace(trans(codesXT) * matAInvZXT) - sumDualVars);
-      double fNew = -(-trace(trans(codesXT) * solve(codesZT +
+      // trace(A^T B) is computed as accu(A % B), which avoids forming the
+      // d x d product.
+      double fOld = -(-accu(codesXT % matAInvZXT) - sumDualVars);
+      double fNew = -(-accu(codesXT % solve(codesZT +
           diagmat(dualVars + alpha * searchDirection), codesXT)) -
           (sumDualVars + alpha * sum(searchDirection)));
 
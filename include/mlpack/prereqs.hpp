@@ -60,6 +60,15 @@ problems.  It should only be necessary to include <mlpack/core.hpp> and not\
   #define force_inline __forceinline
 #endif
 
+// Use OpenMP if the compiler supports it.  Otherwise, the OpenMP pragmas are
+// ignored and we provide serial versions of the OpenMP functions we use.
+#ifdef _OPENMP
+  #include <omp.h>
+#else
+  inline int omp_get_max_threads() { return 1; }
+  inline int omp_get_thread_num() { return 0; }
+#endif
+
 // Now include Armadillo through the special mlpack extensions.
 #include <mlpack/core/arma_extend/arma_extend.hpp>
 